@@ -1,7 +1,12 @@
 #pragma once
 #include <atomic>
+#include <cstdint>
 #include <thread>
 #include <iostream>
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <xmmintrin.h>
+#endif
 #define PTR_TO_INT(PTR) (reinterpret_cast<std::size_t>(PTR))
 #define PTR_TO_CHAR(PTR) (reinterpret_cast<char*>(PTR))
 namespace MemAlloc
@@ -35,7 +40,7 @@ namespace MemAlloc
 			return m_totalSize;
 		}
 
-		std::size_t GetUsedSize() const
+		virtual std::size_t GetUsedSize() const
 		{
 			return m_used;
 		}
@@ -45,10 +50,22 @@ namespace MemAlloc
 		std::size_t m_used = 0;
 	};
 
-	enum ThreadPolicy
+	// Lock policy for allocators used by a single thread. Compiles to no code at all.
+	// Allocators accept any type with lock()/unlock() as a policy: NoLock, Spinlock, std::mutex or a user-supplied one.
+	struct NoLock
 	{
-		NONE = 0,
-		ENABLE_SPIN_LOCK = 1
+		void lock()
+		{
+		}
+
+		void unlock()
+		{
+		}
+
+		bool try_lock()
+		{
+			return true;
+		}
 	};
 
 	class Spinlock
@@ -71,6 +88,11 @@ namespace MemAlloc
 			}
 		}
 
+		bool try_lock()
+		{
+			return !mFlag.load(std::memory_order_relaxed) && !mFlag.exchange(true, std::memory_order_acquire);
+		}
+
 		void unlock()
 		{
 			mFlag.store(false, std::memory_order_release);
@@ -80,21 +102,27 @@ namespace MemAlloc
 		std::atomic_bool mFlag{false};
 	};
 
-	struct SpinlockGuard
+	template <class TLock>
+	struct LockGuard
 	{
-		SpinlockGuard(Spinlock& spinlock) : mSpinlock(spinlock)
+		LockGuard(TLock& lock) : mLock(lock)
 		{
-			mSpinlock.lock();
+			mLock.lock();
 		}
 
-		~SpinlockGuard()
+		LockGuard(const LockGuard&) = delete;
+		LockGuard& operator=(const LockGuard&) = delete;
+
+		~LockGuard()
 		{
-			mSpinlock.unlock();
+			mLock.unlock();
 		}
 
-		Spinlock& mSpinlock;
+		TLock& mLock;
 	};
 
+	using SpinlockGuard = LockGuard<Spinlock>;
+
 	template <class T>
 	class StackLinkedList
 	{
@@ -134,6 +162,81 @@ namespace MemAlloc
 		return top;
 	}
 
+	// Intrusive multi-producer single-consumer queue (Vyukov). Push is wait-free: one exchange and one store.
+	// Pop must be called by a single consumer and may return nullptr while a push is still in progress.
+	class MpscQueue
+	{
+	public:
+		struct Node
+		{
+			std::atomic<Node*> next{nullptr};
+		};
+
+		MpscQueue() = default;
+		MpscQueue(const MpscQueue&) = delete;
+		MpscQueue& operator=(const MpscQueue&) = delete;
+
+		void push(Node* newNode)
+		{
+			newNode->next.store(nullptr, std::memory_order_relaxed);
+			Node* prev = m_tail.exchange(newNode, std::memory_order_acq_rel);
+			prev->next.store(newNode, std::memory_order_release);
+		}
+
+		Node* pop()
+		{
+			Node* head = m_head;
+			Node* next = head->next.load(std::memory_order_acquire);
+
+			if (head == &m_stub)
+			{
+				if (next == nullptr)
+				{
+					return nullptr;
+				}
+
+				m_head = next;
+				head = next;
+				next = next->next.load(std::memory_order_acquire);
+			}
+
+			if (next != nullptr)
+			{
+				m_head = next;
+				return head;
+			}
+
+			if (head != m_tail.load(std::memory_order_acquire))
+			{
+				// A producer has swapped the tail but not linked its node yet
+				return nullptr;
+			}
+
+			push(&m_stub);
+
+			next = head->next.load(std::memory_order_acquire);
+			if (next != nullptr)
+			{
+				m_head = next;
+				return head;
+			}
+
+			return nullptr;
+		}
+
+		// Must be called by the consumer. A push that hasn't linked its node yet already makes the queue non-empty,
+		// even though pop() can't return the node until it does.
+		bool empty() const
+		{
+			return m_head == &m_stub && m_tail.load(std::memory_order_acquire) == &m_stub;
+		}
+
+	private:
+		Node m_stub;
+		Node* m_head = &m_stub;
+		alignas(64) std::atomic<Node*> m_tail{&m_stub};
+	};
+
 	template <class T>
 	struct SinglyLinkedList
 	{
@@ -204,6 +307,50 @@ namespace MemAlloc
 		Node* head;
 	};
 
+	inline void PrefetchForWrite(const void* ptr)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		__builtin_prefetch(ptr, 1);
+#elif defined(_MSC_VER)
+		_mm_prefetch(static_cast<const char*>(ptr), _MM_HINT_T0);
+#endif
+	}
+
+	// Index of the lowest set bit. The value must not be zero.
+	inline std::size_t FindFirstSet(const std::uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanForward64(&index, value);
+		return index;
+#else
+		return static_cast<std::size_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	// Index of the highest set bit. The value must not be zero.
+	inline std::size_t FindLastSet(const std::uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanReverse64(&index, value);
+		return index;
+#else
+		return static_cast<std::size_t>(63 - __builtin_clzll(value));
+#endif
+	}
+
+	constexpr std::size_t cPageSize = 4096;
+
+	// Writes one byte of every page, so that first-touch placement backs the memory with the calling thread's NUMA node
+	inline void TouchPages(char* ptr, const std::size_t size)
+	{
+		for (std::size_t offset = 0; offset < size; offset += cPageSize)
+		{
+			ptr[offset] = 0;
+		}
+	}
+
 	inline char CalculatePadding(const std::size_t baseAddress, const std::size_t alignment)
 	{
 		return  static_cast<char>(alignment - baseAddress % alignment);
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MEMALLOC_X86_64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MEMALLOC_TARGET(isa)
+#else
+#define MEMALLOC_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace MemAlloc
+{
+	// Best-fit search over a struct-of-arrays table of free block sizes: returns the index of the smallest size that
+	// is >= requiredSize, the lowest index among equal sizes, or -1 when none fits.
+	// The slack size - requiredSize is compared as an unsigned number, so the sizes that don't fit wrap around to
+	// huge values and never win, which keeps the loop free of branches.
+	using FindBestFitFunc = int (*)(const std::size_t* sizes, std::size_t count, std::size_t requiredSize);
+
+	inline int FindBestFitScalar(const std::size_t* sizes, const std::size_t count, const std::size_t requiredSize)
+	{
+		std::size_t bestSlack = std::numeric_limits<std::size_t>::max();
+		int bestIndex = -1;
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const std::size_t slack = sizes[i] - requiredSize;
+			if (slack < bestSlack)
+			{
+				bestSlack = slack;
+				bestIndex = static_cast<int>(i);
+			}
+		}
+
+		return bestIndex != -1 && sizes[bestIndex] >= requiredSize ? bestIndex : -1;
+	}
+
+#ifdef MEMALLOC_X86_64
+	// There is no unsigned 64-bit compare before AVX-512, flipping the sign bit turns it into a signed one
+	constexpr std::int64_t cSignBit = std::numeric_limits<std::int64_t>::min();
+
+	constexpr std::size_t cBestFitAccumulatorsNum = 4;
+
+	// Reduces the accumulators of a vector kernel and scans the tail that doesn't fill a whole stride.
+	// Lane k of the stored accumulators holds the smallest biased slack it saw and the start of its stride, the index
+	// of the block is the stride start + k.
+	inline int FinishBestFit(const std::size_t* sizes, const std::size_t count, const std::size_t requiredSize,
+	                         const std::int64_t* laneSlacks, const std::int64_t* laneStrideStarts, const std::size_t lanesNum,
+	                         const std::size_t tailStart)
+	{
+		std::int64_t resultSlack = std::numeric_limits<std::int64_t>::max();
+		std::int64_t resultIndex = -1;
+
+		for (std::size_t lane = 0; lane < lanesNum; ++lane)
+		{
+			if (laneStrideStarts[lane] == -1)
+			{
+				continue;
+			}
+
+			const std::int64_t index = laneStrideStarts[lane] + static_cast<std::int64_t>(lane);
+			if (laneSlacks[lane] < resultSlack || (laneSlacks[lane] == resultSlack && index < resultIndex))
+			{
+				resultSlack = laneSlacks[lane];
+				resultIndex = index;
+			}
+		}
+
+		for (std::size_t i = tailStart; i < count; ++i)
+		{
+			const std::int64_t slack = static_cast<std::int64_t>((sizes[i] - requiredSize) ^ static_cast<std::size_t>(cSignBit));
+			if (slack < resultSlack)
+			{
+				resultSlack = slack;
+				resultIndex = static_cast<std::int64_t>(i);
+			}
+		}
+
+		return resultIndex != -1 && sizes[resultIndex] >= requiredSize ? static_cast<int>(resultIndex) : -1;
+	}
+
+	// Selects the 64-bit lanes of b where the mask is set. The blend of doubles reads one bit per lane, the byte
+	// blend makes the compilers widen the mask first.
+	MEMALLOC_TARGET("sse4.2")
+	inline __m128i BlendSse42(const __m128i a, const __m128i b, const __m128i mask)
+	{
+		return _mm_castpd_si128(_mm_blendv_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b), _mm_castsi128_pd(mask)));
+	}
+
+	MEMALLOC_TARGET("avx2")
+	inline __m256i BlendAvx2(const __m256i a, const __m256i b, const __m256i mask)
+	{
+		return _mm256_castpd_si256(_mm256_blendv_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), _mm256_castsi256_pd(mask)));
+	}
+
+	// Two sizes per instruction, _mm_cmpgt_epi64 needs SSE4.2.
+	// Independent accumulators hide the latency of the compare and blend chain. They only record the start of the
+	// stride, which is shared by all of them and keeps the loop within the 16 vector registers.
+	MEMALLOC_TARGET("sse4.2")
+	inline int FindBestFitSse42(const std::size_t* sizes, const std::size_t count, const std::size_t requiredSize)
+	{
+		constexpr std::size_t cLanesNum = 2;
+		constexpr std::size_t cStride = cLanesNum * cBestFitAccumulatorsNum;
+
+		// Flipping the sign bit is the same as adding it
+		const __m128i bias = _mm_set1_epi64x(static_cast<std::int64_t>(static_cast<std::size_t>(cSignBit) - requiredSize));
+		const __m128i step = _mm_set1_epi64x(cStride);
+
+		__m128i bestSlacks[cBestFitAccumulatorsNum];
+		__m128i bestStrideStarts[cBestFitAccumulatorsNum];
+		for (std::size_t j = 0; j < cBestFitAccumulatorsNum; ++j)
+		{
+			bestSlacks[j] = _mm_set1_epi64x(std::numeric_limits<std::int64_t>::max());
+			bestStrideStarts[j] = _mm_set1_epi64x(-1);
+		}
+		__m128i strideStart = _mm_setzero_si128();
+
+		std::size_t i = 0;
+		for (; i + cStride <= count; i += cStride)
+		{
+			for (std::size_t j = 0; j < cBestFitAccumulatorsNum; ++j)
+			{
+				const __m128i size = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sizes + i + j * cLanesNum));
+				const __m128i slack = _mm_add_epi64(size, bias);
+				const __m128i isLess = _mm_cmpgt_epi64(bestSlacks[j], slack);
+
+				bestSlacks[j] = BlendSse42(bestSlacks[j], slack, isLess);
+				bestStrideStarts[j] = BlendSse42(bestStrideStarts[j], strideStart, isLess);
+			}
+			strideStart = _mm_add_epi64(strideStart, step);
+		}
+
+		alignas(16) std::int64_t laneSlacks[cStride];
+		alignas(16) std::int64_t laneStrideStarts[cStride];
+		for (std::size_t j = 0; j < cBestFitAccumulatorsNum; ++j)
+		{
+			_mm_store_si128(reinterpret_cast<__m128i*>(laneSlacks + j * cLanesNum), bestSlacks[j]);
+			_mm_store_si128(reinterpret_cast<__m128i*>(laneStrideStarts + j * cLanesNum), bestStrideStarts[j]);
+		}
+
+		return FinishBestFit(sizes, count, requiredSize, laneSlacks, laneStrideStarts, cStride, i);
+	}
+
+	// Four sizes per instruction
+	MEMALLOC_TARGET("avx2")
+	inline int FindBestFitAvx2(const std::size_t* sizes, const std::size_t count, const std::size_t requiredSize)
+	{
+		constexpr std::size_t cLanesNum = 4;
+		constexpr std::size_t cStride = cLanesNum * cBestFitAccumulatorsNum;
+
+		const __m256i bias = _mm256_set1_epi64x(static_cast<std::int64_t>(static_cast<std::size_t>(cSignBit) - requiredSize));
+		const __m256i step = _mm256_set1_epi64x(cStride);
+
+		__m256i bestSlacks[cBestFitAccumulatorsNum];
+		__m256i bestStrideStarts[cBestFitAccumulatorsNum];
+		for (std::size_t j = 0; j < cBestFitAccumulatorsNum; ++j)
+		{
+			bestSlacks[j] = _mm256_set1_epi64x(std::numeric_limits<std::int64_t>::max());
+			bestStrideStarts[j] = _mm256_set1_epi64x(-1);
+		}
+		__m256i strideStart = _mm256_setzero_si256();
+
+		std::size_t i = 0;
+		for (; i + cStride <= count; i += cStride)
+		{
+			for (std::size_t j = 0; j < cBestFitAccumulatorsNum; ++j)
+			{
+				const __m256i size = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sizes + i + j * cLanesNum));
+				const __m256i slack = _mm256_add_epi64(size, bias);
+				const __m256i isLess = _mm256_cmpgt_epi64(bestSlacks[j], slack);
+
+				bestSlacks[j] = BlendAvx2(bestSlacks[j], slack, isLess);
+				bestStrideStarts[j] = BlendAvx2(bestStrideStarts[j], strideStart, isLess);
+			}
+			strideStart = _mm256_add_epi64(strideStart, step);
+		}
+
+		alignas(32) std::int64_t laneSlacks[cStride];
+		alignas(32) std::int64_t laneStrideStarts[cStride];
+		for (std::size_t j = 0; j < cBestFitAccumulatorsNum; ++j)
+		{
+			_mm256_store_si256(reinterpret_cast<__m256i*>(laneSlacks + j * cLanesNum), bestSlacks[j]);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(laneStrideStarts + j * cLanesNum), bestStrideStarts[j]);
+		}
+
+		return FinishBestFit(sizes, count, requiredSize, laneSlacks, laneStrideStarts, cStride, i);
+	}
+
+	inline bool IsSse42Supported()
+	{
+#ifdef _MSC_VER
+		int cpuInfo[4] = {};
+		__cpuid(cpuInfo, 1);
+		return (cpuInfo[2] & (1 << 20)) != 0;
+#else
+		return __builtin_cpu_supports("sse4.2");
+#endif
+	}
+
+	inline bool IsAvx2Supported()
+	{
+#ifdef _MSC_VER
+		int cpuInfo[4] = {};
+		__cpuid(cpuInfo, 1);
+		const bool hasOsXsave = (cpuInfo[2] & (1 << 27)) != 0;
+		__cpuidex(cpuInfo, 7, 0);
+		const bool hasAvx2 = (cpuInfo[1] & (1 << 5)) != 0;
+
+		// The OS must also save the YMM registers
+		return hasOsXsave && hasAvx2 && (_xgetbv(0) & 0x6) == 0x6;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+	// Picks the widest kernel the CPU runs
+	inline FindBestFitFunc SelectFindBestFit()
+	{
+#ifdef MEMALLOC_X86_64
+		if (IsAvx2Supported())
+		{
+			return FindBestFitAvx2;
+		}
+
+		if (IsSse42Supported())
+		{
+			return FindBestFitSse42;
+		}
+#endif
+
+		return FindBestFitScalar;
+	}
+
+	// The kernel is selected on the first call, so it also works from static initializers
+	inline int FindBestFit(const std::size_t* sizes, const std::size_t count, const std::size_t requiredSize)
+	{
+		static const FindBestFitFunc sFindBestFit = SelectFindBestFit();
+		return sFindBestFit(sizes, count, requiredSize);
+	}
+}
@@ -0,0 +1,119 @@
+#include "BestFitSearch.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace MemAlloc;
+
+static std::vector<std::size_t> MakeFreeBlockSizes(const std::size_t count)
+{
+	std::vector<std::size_t> sizes(count);
+	for (auto& size : sizes)
+	{
+		size = (rand() % sMaxChunkSize + 1) * sizeof(std::size_t);
+	}
+
+	return sizes;
+}
+
+static void RunTest()
+{
+	std::cout << "StartTest: BestFitSearch\n";
+	std::cout << "Desc: Compares the vector kernels supported by the CPU with the scalar one on tables of random sizes.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
+
+	std::vector<FindBestFitFunc> kernels;
+#ifdef MEMALLOC_X86_64
+	if (IsSse42Supported())
+	{
+		kernels.emplace_back(FindBestFitSse42);
+	}
+	if (IsAvx2Supported())
+	{
+		kernels.emplace_back(FindBestFitAvx2);
+	}
+#endif
+
+	bool isPassed = true;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	// Odd counts leave a scalar tail, sizes that none of the blocks fits must return -1
+	for (std::size_t count = 0; count < sMaxChunksNum; count += count / 2 + 1)
+	{
+		const std::vector<std::size_t> sizes = MakeFreeBlockSizes(count);
+
+		for (std::size_t requiredSize = sizeof(std::size_t); requiredSize <= sMaxChunkSize * sizeof(std::size_t) + 1;
+		     requiredSize += rand() % 512 + 1)
+		{
+			const int expectedIndex = FindBestFitScalar(sizes.data(), count, requiredSize);
+			for (const FindBestFitFunc kernel : kernels)
+			{
+				isPassed &= kernel(sizes.data(), count, requiredSize) == expectedIndex;
+			}
+			isPassed &= FindBestFit(sizes.data(), count, requiredSize) == expectedIndex;
+		}
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (isPassed)
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+	else
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("BestFitSearch     ", duration);
+}
+
+TEST_REGISTER(BestFitSearchTest, RunTest);
+
+static bool IsScalarSupported()
+{
+	return true;
+}
+
+// Best-fit search over state.range(0) free blocks, skipped when the CPU lacks the instruction set of the kernel
+template <FindBestFitFunc TKernel, bool (*TIsSupported)()>
+static void BM_FindBestFit(benchmark::State& state)
+{
+	if (!TIsSupported())
+	{
+		state.SkipWithError("The CPU doesn't support the kernel");
+		return;
+	}
+
+	const std::size_t count = static_cast<std::size_t>(state.range(0));
+	const std::vector<std::size_t> sizes = MakeFreeBlockSizes(count);
+
+	std::vector<std::size_t> requiredSizes(1024);
+	for (auto& requiredSize : requiredSizes)
+	{
+		requiredSize = (rand() % sMaxChunkSize + 1) * sizeof(std::size_t);
+	}
+
+	std::size_t sizeIdx = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(TKernel(sizes.data(), count, requiredSizes[sizeIdx]));
+		sizeIdx = (sizeIdx + 1) % requiredSizes.size();
+	}
+
+	state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK_TEMPLATE(BM_FindBestFit, FindBestFitScalar, IsScalarSupported)->Arg(100)->Arg(1000)->Arg(10000);
+#ifdef MEMALLOC_X86_64
+BENCHMARK_TEMPLATE(BM_FindBestFit, FindBestFitSse42, IsSse42Supported)->Arg(100)->Arg(1000)->Arg(10000);
+BENCHMARK_TEMPLATE(BM_FindBestFit, FindBestFitAvx2, IsAvx2Supported)->Arg(100)->Arg(1000)->Arg(10000);
+#endif
\ No newline at end of file
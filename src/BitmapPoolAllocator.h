@@ -0,0 +1,204 @@
+#pragma once
+
+#include "AllocatorInterface.h"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace MemAlloc
+{
+	constexpr std::size_t cBitmapWordBits = 64;
+
+	// Pool allocator that tracks its free chunks with one bit each instead of one pointer each, which takes
+	// 64 times less metadata than PoolAllocator. A summary bitmap has a bit per word that still has a free chunk, so
+	// Allocate skips 64 full words with a single find-first-set. The search starts from the lowest summary word that
+	// may have a free chunk, which keeps the allocations packed at the start of the pool. Reset is a memset.
+	// TLock is the locking policy of the instance, NoLock by default (see AllocatorInterface.h)
+	template <class TLock = NoLock>
+	class BitmapPoolAllocator final : public AllocatorInterface
+	{
+		static constexpr std::size_t cNoChunkSizeShift = 64;
+
+	public:
+		BitmapPoolAllocator(const BitmapPoolAllocator&) = delete;
+
+		BitmapPoolAllocator(const std::size_t chunksNum, const std::size_t chunkSize)
+			: AllocatorInterface(chunksNum * chunkSize), m_chunksNum(chunksNum), m_chunkSize(chunkSize),
+			  m_wordsNum((chunksNum + cBitmapWordBits - 1) / cBitmapWordBits),
+			  m_summaryWordsNum((m_wordsNum + cBitmapWordBits - 1) / cBitmapWordBits),
+			  m_chunkSizeShift((chunkSize & (chunkSize - 1)) == 0 ? FindFirstSet(chunkSize) : cNoChunkSizeShift)
+		{
+			assert(((chunkSize % sizeof(std::size_t)) == 0) && "Chunk size must be aligned to std::size_t");
+		}
+
+		~BitmapPoolAllocator() override
+		{
+			free(m_start_ptr);
+			free(m_freeBits);
+			free(m_summaryBits);
+		}
+
+		void Init() override
+		{
+			free(m_start_ptr);
+			free(m_freeBits);
+			free(m_summaryBits);
+
+			m_start_ptr = static_cast<char*>(malloc(m_totalSize));
+			m_freeBits = static_cast<std::uint64_t*>(malloc(m_wordsNum * sizeof(std::uint64_t)));
+			m_summaryBits = static_cast<std::uint64_t*>(malloc(m_summaryWordsNum * sizeof(std::uint64_t)));
+
+			Reset();
+		}
+
+		void* Allocate(const std::size_t allocationSize, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			void* dataAddress = TryAllocate(allocationSize, alignment);
+			assert(dataAddress != nullptr && "The pool allocator is full");
+
+			return dataAddress;
+		}
+
+		// Same as Allocate but returns nullptr when the pool is full
+		void* TryAllocate(const std::size_t allocationSize, const std::size_t alignment = sizeof(std::size_t))
+		{
+			assert(allocationSize <= m_chunkSize && "Allocation size must be <= to chunk size");
+
+			LockGuard<TLock> guard(m_lock);
+
+			// The summary words below the hint are known to be zero
+			std::size_t summaryIdx = m_summaryHint;
+			if (m_summaryBits[summaryIdx] == 0)
+			{
+				do
+				{
+					++summaryIdx;
+				} while (summaryIdx < m_summaryWordsNum && m_summaryBits[summaryIdx] == 0);
+
+				if (summaryIdx == m_summaryWordsNum)
+				{
+					return nullptr;
+				}
+
+				// Stored only when it moves, so that the next call doesn't wait for the store
+				m_summaryHint = summaryIdx;
+			}
+
+			const std::size_t wordIdx = summaryIdx * cBitmapWordBits + FindFirstSet(m_summaryBits[summaryIdx]);
+			std::uint64_t& word = m_freeBits[wordIdx];
+			const std::size_t chunkIdx = wordIdx * cBitmapWordBits + FindFirstSet(word);
+
+			// Clears the lowest set bit
+			word &= word - 1;
+			if (word == 0)
+			{
+				m_summaryBits[summaryIdx] &= ~(std::uint64_t{1} << (wordIdx % cBitmapWordBits));
+			}
+
+			m_used += m_chunkSize;
+
+			void* dataAddress = m_start_ptr + chunkIdx * m_chunkSize;
+			assert(PTR_TO_INT(dataAddress) % alignment == 0 && "Data address must be aligment");
+
+			return dataAddress;
+		}
+
+		bool Free(void* ptr) override
+		{
+			if (!Contains(ptr))
+			{
+				return false;
+			}
+
+			const std::size_t chunkIdx = GetChunkIndex(static_cast<std::size_t>(PTR_TO_CHAR(ptr) - m_start_ptr));
+			assert(m_start_ptr + chunkIdx * m_chunkSize == ptr && "Pointer must be the start of a chunk");
+
+			const std::size_t wordIdx = chunkIdx / cBitmapWordBits;
+			const std::size_t summaryIdx = wordIdx / cBitmapWordBits;
+
+			LockGuard<TLock> guard(m_lock);
+
+			assert((m_freeBits[wordIdx] & (std::uint64_t{1} << (chunkIdx % cBitmapWordBits))) == 0 && "Double free");
+
+			const std::uint64_t word = m_freeBits[wordIdx];
+			m_freeBits[wordIdx] = word | (std::uint64_t{1} << (chunkIdx % cBitmapWordBits));
+
+			// Only the first free chunk of a word touches the summary
+			if (word == 0)
+			{
+				m_summaryBits[summaryIdx] |= std::uint64_t{1} << (wordIdx % cBitmapWordBits);
+				if (summaryIdx < m_summaryHint)
+				{
+					m_summaryHint = summaryIdx;
+				}
+			}
+
+			m_used -= m_chunkSize;
+
+			return true;
+		}
+
+		void Reset()
+		{
+			LockGuard<TLock> guard(m_lock);
+
+			m_used = 0;
+			m_summaryHint = 0;
+
+			FillBits(m_freeBits, m_wordsNum, m_chunksNum);
+			FillBits(m_summaryBits, m_summaryWordsNum, m_wordsNum);
+		}
+
+		std::size_t GetChunkSize() const
+		{
+			return m_chunkSize;
+		}
+
+		// Size of the free chunks bitmap and of its summary
+		std::size_t GetMetadataSize() const
+		{
+			return (m_wordsNum + m_summaryWordsNum) * sizeof(std::uint64_t);
+		}
+
+		bool Contains(const void* ptr) const
+		{
+			return ptr >= m_start_ptr && ptr < m_start_ptr + m_totalSize;
+		}
+
+		// Must be called after Init and before any chunk is allocated
+		void FirstTouch()
+		{
+			TouchPages(m_start_ptr, m_totalSize);
+		}
+
+	private:
+		// A shift instead of a division for the common power of two chunk sizes
+		std::size_t GetChunkIndex(const std::size_t offset) const
+		{
+			return m_chunkSizeShift != cNoChunkSizeShift ? offset >> m_chunkSizeShift : offset / m_chunkSize;
+		}
+
+		// Sets the first bitsNum bits and clears the rest of the last word
+		static void FillBits(std::uint64_t* words, const std::size_t wordsNum, const std::size_t bitsNum)
+		{
+			std::memset(words, 0xFF, wordsNum * sizeof(std::uint64_t));
+
+			if (bitsNum % cBitmapWordBits != 0)
+			{
+				words[wordsNum - 1] = (std::uint64_t{1} << (bitsNum % cBitmapWordBits)) - 1;
+			}
+		}
+
+	private:
+		char* m_start_ptr = nullptr;
+		std::uint64_t* m_freeBits = nullptr; // A set bit is a free chunk
+		std::uint64_t* m_summaryBits = nullptr; // A set bit is a word of m_freeBits with a free chunk
+		std::size_t m_chunksNum = 0;
+		std::size_t m_chunkSize = 0;
+		std::size_t m_wordsNum = 0;
+		std::size_t m_summaryWordsNum = 0;
+		std::size_t m_chunkSizeShift = cNoChunkSizeShift;
+		std::size_t m_summaryHint = 0;
+		TLock m_lock;
+	};
+} // namespace MemAlloc
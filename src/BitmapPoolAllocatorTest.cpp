@@ -0,0 +1,132 @@
+#include "BitmapPoolAllocator.h"
+#include "PoolAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace MemAlloc;
+
+static void RunTest()
+{
+	constexpr std::size_t chunkSize = 64;
+	// Spans several summary words, and the last bitmap word is partial
+	const std::size_t chunksNum = sMaxChunksNum * cBitmapWordBits + 37;
+
+	std::cout << "StartTest: BitmapPoolAllocator\n";
+	std::cout << "Desc: Allocates every chunk of a pool of " << chunkSize << " bytes chunks, marks them and deallocates in random order. The pool must be full in between and empty after.\n";
+	std::cout << "MaxChunksNum " << chunksNum << "\n";
+
+	BitmapPoolAllocator<> allocator(chunksNum, chunkSize);
+	allocator.Init();
+
+	std::vector<void*> memPointers;
+	memPointers.reserve(chunksNum);
+
+	bool corrupted = false;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	for (std::size_t i = 0; i < chunksNum; ++i)
+	{
+		auto* p = static_cast<std::size_t*>(allocator.Allocate(sizeof(std::size_t)));
+		*p = i;
+		memPointers.emplace_back(p);
+	}
+
+	const bool isFull = allocator.TryAllocate(sizeof(std::size_t)) == nullptr;
+
+	std::vector<std::size_t> freeOrder(chunksNum);
+	for (std::size_t i = 0; i < chunksNum; ++i)
+	{
+		freeOrder[i] = i;
+	}
+	std::shuffle(freeOrder.begin(), freeOrder.end(), std::mt19937(rand()));
+
+	for (const std::size_t idx : freeOrder)
+	{
+		corrupted |= *static_cast<std::size_t*>(memPointers[idx]) != idx;
+		allocator.Free(memPointers[idx]);
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	// Each chunk is handed out once, so the lowest free chunk comes back first
+	const bool isPacked = allocator.Allocate(sizeof(std::size_t)) == *std::min_element(memPointers.begin(), memPointers.end());
+
+	if (allocator.GetUsedSize() != chunkSize || !isFull || !isPacked || corrupted)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("BitmapPoolAlloc   ", duration);
+}
+
+TEST_REGISTER(BitmapPoolAllocatorTest, RunTest);
+
+// Allocates all state.range(0) chunks of the pool, writes to each like a caller would and frees them in random order.
+// After the first iteration PoolAllocator hands the chunks out in the random order they were freed in,
+// BitmapPoolAllocator in address order.
+template <class TPool>
+static void BM_PoolFillAndFree(benchmark::State& state)
+{
+	const std::size_t chunksNum = static_cast<std::size_t>(state.range(0));
+
+	TPool allocator(chunksNum, 64);
+	allocator.Init();
+
+	std::vector<std::size_t> freeOrder(chunksNum);
+	for (std::size_t i = 0; i < chunksNum; ++i)
+	{
+		freeOrder[i] = i;
+	}
+	std::shuffle(freeOrder.begin(), freeOrder.end(), std::mt19937(rand()));
+
+	std::vector<void*> memPointers(chunksNum);
+
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < chunksNum; ++i)
+		{
+			memPointers[i] = allocator.Allocate(64);
+			*static_cast<std::size_t*>(memPointers[i]) = i;
+		}
+
+		for (const std::size_t idx : freeOrder)
+		{
+			allocator.Free(memPointers[idx]);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * 2 * chunksNum);
+}
+
+BENCHMARK(BM_PoolFillAndFree<PoolAllocator<>>)->Arg(1000)->Arg(100000)->Arg(10000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PoolFillAndFree<BitmapPoolAllocator<>>)->Arg(1000)->Arg(100000)->Arg(10000000)->Unit(benchmark::kMicrosecond);
+
+template <class TPool>
+static void BM_PoolReset(benchmark::State& state)
+{
+	const std::size_t chunksNum = static_cast<std::size_t>(state.range(0));
+
+	TPool allocator(chunksNum, 64);
+	allocator.Init();
+
+	for (auto _ : state)
+	{
+		allocator.Reset();
+		benchmark::ClobberMemory();
+	}
+}
+
+BENCHMARK(BM_PoolReset<PoolAllocator<>>)->Arg(1000)->Arg(100000)->Arg(10000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PoolReset<BitmapPoolAllocator<>>)->Arg(1000)->Arg(100000)->Arg(10000000)->Unit(benchmark::kMicrosecond);
\ No newline at end of file
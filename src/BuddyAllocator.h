@@ -0,0 +1,294 @@
+#pragma once
+
+#include "AllocatorInterface.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace MemAlloc
+{
+	constexpr std::size_t cBuddyMinBlockSizeLog2 = 5;
+	constexpr std::size_t cBuddyMinBlockSize = std::size_t{1} << cBuddyMinBlockSizeLog2;
+	constexpr std::size_t cBuddyOrdersNum = 48;
+
+	// Binary buddy allocator. The arena is a power of two that is split in halves until a block of the smallest
+	// power of two that fits the allocation remains. Free blocks are kept in a doubly linked list per order, and a
+	// bitmap holds one bit per pair of buddies: whether exactly one of them is free. Free toggles the bit of its
+	// block and, if the buddy turns out to be free too, unlinks it and merges one order up, so splitting and merging
+	// are O(log n) without any search. A mask of the non-empty lists finds the order to split from in O(1).
+	// Sizes are rounded up to a power of two, so the waste is bounded by half of each block. The order of an allocated
+	// block is kept in a byte per smallest block on the side rather than in a header, so a power of two size takes a
+	// block of exactly that size, aligned to its size relative to the arena start.
+	// TLock is the locking policy of the instance, NoLock by default (see AllocatorInterface.h)
+	template <class TLock = NoLock>
+	class BuddyAllocator final : public AllocatorInterface
+	{
+		// The links live in the free block itself
+		struct FreeBlock
+		{
+			FreeBlock* m_next;
+			FreeBlock* m_prev;
+		};
+
+		static constexpr std::uint8_t cNoBlockOrder = 0xFF;
+
+		static_assert(sizeof(FreeBlock) <= cBuddyMinBlockSize, "A free block must fit its links");
+
+	public:
+		BuddyAllocator(const BuddyAllocator&) = delete;
+
+		// The total size is rounded up to a power of two
+		BuddyAllocator(const std::size_t totalSize)
+			: AllocatorInterface(RoundUpToPowerOfTwo(totalSize < cBuddyMinBlockSize ? cBuddyMinBlockSize : totalSize)),
+			  m_maxOrder(FindLastSet(m_totalSize) - cBuddyMinBlockSizeLog2)
+		{
+			assert(m_maxOrder < cBuddyOrdersNum && "Total size is too big");
+
+			// The pairs of order k are 2^(m_maxOrder - k - 1), the top order has no buddy
+			std::size_t pairsNum = 0;
+			for (std::size_t order = 0; order < m_maxOrder; ++order)
+			{
+				m_pairBitsOffsets[order] = pairsNum;
+				pairsNum += std::size_t{1} << (m_maxOrder - order - 1);
+			}
+			m_pairWordsNum = (pairsNum + 63) / 64;
+			m_minBlocksNum = m_totalSize >> cBuddyMinBlockSizeLog2;
+		}
+
+		~BuddyAllocator() override
+		{
+			free(m_start_ptr);
+			free(m_pairBits);
+			free(m_blockOrders);
+		}
+
+		void Init() override
+		{
+			free(m_start_ptr);
+			free(m_pairBits);
+			free(m_blockOrders);
+
+			m_start_ptr = static_cast<char*>(malloc(m_totalSize));
+			m_pairBits = static_cast<std::uint64_t*>(malloc((m_pairWordsNum > 0 ? m_pairWordsNum : 1) * sizeof(std::uint64_t)));
+			m_blockOrders = static_cast<std::uint8_t*>(malloc(m_minBlocksNum));
+
+			Reset();
+		}
+
+		// Blocks are aligned to their size relative to the arena start, which comes from malloc, so the address is
+		// only aligned to alignof(std::max_align_t). An alignment bigger than the size takes a bigger block.
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			void* resultPtr = TryAllocate(size, alignment);
+			assert(resultPtr != nullptr && "Not enough memory");
+
+			return resultPtr;
+		}
+
+		// Same as Allocate but returns nullptr when there is no block to fit the size
+		void* TryAllocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t))
+		{
+			assert(alignment <= alignof(std::max_align_t) && "Unsupported alignment");
+
+			const std::size_t order = GetOrder(size > alignment ? size : alignment);
+			if (order > m_maxOrder)
+			{
+				return nullptr;
+			}
+
+			LockGuard<TLock> guard(m_lock);
+
+			const std::uint64_t fittingOrders = m_freeListsMask & (~std::uint64_t{0} << order);
+			if (fittingOrders == 0)
+			{
+				return nullptr;
+			}
+
+			std::size_t blockOrder = FindFirstSet(fittingOrders);
+			char* block = reinterpret_cast<char*>(m_freeLists[blockOrder]);
+			RemoveFreeBlock(block, blockOrder);
+			TogglePairBit(block, blockOrder);
+
+			// Splits down to the order, the upper halves become free buddies
+			while (blockOrder > order)
+			{
+				--blockOrder;
+				InsertFreeBlock(block + GetBlockSize(blockOrder), blockOrder);
+				TogglePairBit(block, blockOrder);
+			}
+
+			m_blockOrders[GetMinBlockIndex(block)] = static_cast<std::uint8_t>(order);
+			m_used += GetBlockSize(order);
+
+			return block;
+		}
+
+		bool Free(void* ptr) override
+		{
+			if (!Contains(ptr))
+			{
+				return false;
+			}
+
+			char* block = PTR_TO_CHAR(ptr);
+			const std::size_t blockIdx = GetMinBlockIndex(block);
+			assert((block - m_start_ptr) % cBuddyMinBlockSize == 0 && "Pointer must be the start of a block");
+
+			LockGuard<TLock> guard(m_lock);
+
+			std::size_t order = m_blockOrders[blockIdx];
+			assert(order != cNoBlockOrder && "Double free");
+			m_blockOrders[blockIdx] = cNoBlockOrder;
+
+			m_used -= GetBlockSize(order);
+
+			// A pair bit that drops to 0 means that the buddy is free as well
+			while (order < m_maxOrder && !TogglePairBit(block, order))
+			{
+				char* buddy = GetBuddy(block, order);
+				RemoveFreeBlock(buddy, order);
+
+				block = buddy < block ? buddy : block;
+				++order;
+			}
+
+			InsertFreeBlock(block, order);
+
+			return true;
+		}
+
+		void Reset()
+		{
+			LockGuard<TLock> guard(m_lock);
+
+			m_used = 0;
+			m_freeListsMask = 0;
+			std::memset(m_freeLists, 0, sizeof(m_freeLists));
+			std::memset(m_pairBits, 0, m_pairWordsNum * sizeof(std::uint64_t));
+			std::memset(m_blockOrders, cNoBlockOrder, m_minBlocksNum);
+
+			InsertFreeBlock(m_start_ptr, m_maxOrder);
+		}
+
+		bool Contains(const void* ptr) const
+		{
+			return ptr >= m_start_ptr && ptr < m_start_ptr + m_totalSize;
+		}
+
+		// Must be called after Init and before any block is allocated
+		void FirstTouch()
+		{
+			TouchPages(m_start_ptr, m_totalSize);
+			Reset();
+		}
+
+		std::size_t GetMaxOrder() const
+		{
+			return m_maxOrder;
+		}
+
+		bool IsFullyMerged() const
+		{
+			return m_freeListsMask == (std::uint64_t{1} << m_maxOrder) &&
+				m_freeLists[m_maxOrder] == reinterpret_cast<const FreeBlock*>(m_start_ptr);
+		}
+
+	private:
+		static std::size_t RoundUpToPowerOfTwo(const std::size_t size)
+		{
+			return size <= 1 ? 1 : std::size_t{1} << (FindLastSet(size - 1) + 1);
+		}
+
+		// Order of the smallest block that fits the size
+		static std::size_t GetOrder(const std::size_t size)
+		{
+			if (size <= cBuddyMinBlockSize)
+			{
+				return 0;
+			}
+
+			return FindLastSet(size - 1) + 1 - cBuddyMinBlockSizeLog2;
+		}
+
+		static std::size_t GetBlockSize(const std::size_t order)
+		{
+			return cBuddyMinBlockSize << order;
+		}
+
+		std::size_t GetMinBlockIndex(const char* block) const
+		{
+			return static_cast<std::size_t>(block - m_start_ptr) >> cBuddyMinBlockSizeLog2;
+		}
+
+		char* GetBuddy(char* block, const std::size_t order) const
+		{
+			return m_start_ptr + (static_cast<std::size_t>(block - m_start_ptr) ^ GetBlockSize(order));
+		}
+
+		// Flips whether exactly one block of the pair is free and returns the new value
+		bool TogglePairBit(const char* block, const std::size_t order)
+		{
+			if (order == m_maxOrder)
+			{
+				return false;
+			}
+
+			const std::size_t pairIdx = m_pairBitsOffsets[order] +
+				(static_cast<std::size_t>(block - m_start_ptr) >> (cBuddyMinBlockSizeLog2 + order + 1));
+			std::uint64_t& word = m_pairBits[pairIdx / 64];
+			const std::uint64_t mask = std::uint64_t{1} << (pairIdx % 64);
+
+			word ^= mask;
+			return (word & mask) != 0;
+		}
+
+		void InsertFreeBlock(char* block, const std::size_t order)
+		{
+			auto* freeBlock = reinterpret_cast<FreeBlock*>(block);
+			freeBlock->m_prev = nullptr;
+			freeBlock->m_next = m_freeLists[order];
+			if (freeBlock->m_next != nullptr)
+			{
+				freeBlock->m_next->m_prev = freeBlock;
+			}
+
+			m_freeLists[order] = freeBlock;
+			m_freeListsMask |= std::uint64_t{1} << order;
+		}
+
+		void RemoveFreeBlock(char* block, const std::size_t order)
+		{
+			auto* freeBlock = reinterpret_cast<FreeBlock*>(block);
+			if (freeBlock->m_prev != nullptr)
+			{
+				freeBlock->m_prev->m_next = freeBlock->m_next;
+			}
+			else
+			{
+				m_freeLists[order] = freeBlock->m_next;
+				if (m_freeLists[order] == nullptr)
+				{
+					m_freeListsMask &= ~(std::uint64_t{1} << order);
+				}
+			}
+
+			if (freeBlock->m_next != nullptr)
+			{
+				freeBlock->m_next->m_prev = freeBlock->m_prev;
+			}
+		}
+
+	private:
+		char* m_start_ptr = nullptr;
+		std::size_t m_maxOrder = 0;
+		std::uint64_t* m_pairBits = nullptr; // A set bit is a pair of buddies with exactly one free block
+		std::size_t m_pairWordsNum = 0;
+		std::size_t m_pairBitsOffsets[cBuddyOrdersNum] = {};
+		std::uint8_t* m_blockOrders = nullptr; // Order of the allocated block that starts at each smallest block
+		std::size_t m_minBlocksNum = 0;
+		std::uint64_t m_freeListsMask = 0; // A set bit is a non-empty free list
+		FreeBlock* m_freeLists[cBuddyOrdersNum] = {};
+		TLock m_lock;
+	};
+} // namespace MemAlloc
@@ -0,0 +1,112 @@
+#include "BuddyAllocator.h"
+#include "FreeListAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace MemAlloc;
+
+static void RunTest()
+{
+	std::cout << "StartTest: BuddyAllocator\n";
+	std::cout << "Desc: Allocates chunks(MaxChunksNum) of size = 'rand() % sMaxChunkSize + 1', marks them and deallocates in random order.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
+
+	BuddyAllocator<> allocator(sMaxChunksNum * sMaxChunkSize);
+	allocator.Init();
+
+	std::vector<std::size_t*> memPointers;
+	memPointers.reserve(sMaxChunksNum);
+
+	bool corrupted = false;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	for (std::size_t i = 0; i < sMaxChunksNum; ++i)
+	{
+		const auto size = rand() % sMaxChunkSize + 1;
+		auto* p = static_cast<std::size_t*>(allocator.Allocate(size));
+		*p = size;
+		memPointers.emplace_back(p);
+	}
+
+	for (int i = sMaxChunksNum - 1; i >= 0; --i)
+	{
+		const auto idx = (i != 0 ? rand() % i : 0);
+		// A chunk is marked with its size, which an overlapping chunk would have overwritten
+		corrupted |= *memPointers[idx] == 0 || *memPointers[idx] > sMaxChunkSize;
+		allocator.Free(memPointers[idx]);
+		memPointers.erase(memPointers.begin() + idx);
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (allocator.GetUsedSize() > 0 || corrupted)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	if (allocator.IsFullyMerged())
+	{
+		std::cout << green << "FullMerge Test Passed!\n" << white;
+	}
+	else
+	{
+		std::cout << red << "FullMerge Test Failed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("BuddyAllocator    ", duration);
+}
+
+TEST_REGISTER(BuddyAllocatorTest, RunTest);
+
+// Allocates and frees state.range(0) buffers of power of two sizes from 64 bytes to 4 KiB in random order,
+// the sizes network buffers and hash table arrays come in
+template <class TAllocator>
+static void BM_PowerOfTwoChurn(benchmark::State& state)
+{
+	const std::size_t buffersNum = static_cast<std::size_t>(state.range(0));
+
+	TAllocator allocator(2 * buffersNum * 4096);
+	allocator.Init();
+
+	std::vector<std::size_t> sizes(buffersNum);
+	std::vector<std::size_t> freeOrder(buffersNum);
+	for (std::size_t i = 0; i < buffersNum; ++i)
+	{
+		sizes[i] = std::size_t{64} << (rand() % 7);
+		freeOrder[i] = i;
+	}
+	std::shuffle(freeOrder.begin(), freeOrder.end(), std::mt19937(rand()));
+
+	std::vector<void*> memPointers(buffersNum);
+
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < buffersNum; ++i)
+		{
+			memPointers[i] = allocator.Allocate(sizes[i]);
+		}
+
+		for (const std::size_t idx : freeOrder)
+		{
+			allocator.Free(memPointers[idx]);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * 2 * buffersNum);
+}
+
+BENCHMARK(BM_PowerOfTwoChurn<FreeListAllocator<>>)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PowerOfTwoChurn<BuddyAllocator<>>)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
\ No newline at end of file
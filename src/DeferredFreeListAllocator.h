@@ -0,0 +1,177 @@
+#pragma once
+
+#include "FreeListAllocator.h"
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <new>
+
+namespace MemAlloc
+{
+	constexpr std::size_t cDeferredFreeWakeupThreshold = 256;
+	constexpr std::size_t cDeferredFreeDrainBatchSize = 64;
+	constexpr std::chrono::milliseconds cMaintenanceInterval(1);
+
+	// FreeListAllocator whose Free() only pushes the block onto a wait-free MPSC queue.
+	// A background maintenance thread returns the queued blocks to the free list, a batch per lock acquisition,
+	// where the boundary tags merge them with their neighbours right away, so merging never runs on the freeing thread.
+	// Allocate() takes already merged blocks and drains the queue itself only when nothing fits.
+	// With deferred = false it behaves as a plain locked FreeListAllocator.
+	template <class TLock = Spinlock>
+	class DeferredFreeListAllocator final : public AllocatorInterface
+	{
+	public:
+		DeferredFreeListAllocator(const DeferredFreeListAllocator&) = delete;
+
+		DeferredFreeListAllocator(const std::size_t totalSize, const bool deferred = true)
+			: AllocatorInterface(totalSize), m_arena(totalSize), m_deferred(deferred)
+		{
+		}
+
+		~DeferredFreeListAllocator() override
+		{
+			if (m_maintenanceThread.joinable())
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_wakeupMutex);
+					m_stop = true;
+				}
+				m_wakeup.notify_one();
+				m_maintenanceThread.join();
+			}
+		}
+
+		void Init() override
+		{
+			m_arena.Init();
+
+			if (m_deferred && !m_maintenanceThread.joinable())
+			{
+				m_maintenanceThread = std::thread(&DeferredFreeListAllocator::MaintenanceLoop, this);
+			}
+		}
+
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			LockGuard<TLock> guard(m_lock);
+
+			void* resultPtr = m_arena.TryAllocate(size, alignment);
+
+			// A deferred Free may still be linking its block, which the queue can't pop yet, so keep draining
+			// until nothing is pending rather than report the arena full
+			while (resultPtr == nullptr && (m_pendingNum.load(std::memory_order_relaxed) > 0 || !m_deferredFrees.empty()))
+			{
+				DrainDeferredFrees(std::numeric_limits<std::size_t>::max());
+				resultPtr = m_arena.TryAllocate(size, alignment);
+			}
+
+			assert(resultPtr != nullptr && "Not enough memory");
+			return resultPtr;
+		}
+
+		bool Free(void* ptr) override
+		{
+			if (!m_arena.Contains(ptr))
+			{
+				return false;
+			}
+
+			if (!m_deferred)
+			{
+				LockGuard<TLock> guard(m_lock);
+				return m_arena.Free(ptr);
+			}
+
+			// The allocation header in front of ptr stays intact, the queue node fits in the smallest block
+			m_deferredFrees.push(new (ptr) MpscQueue::Node());
+
+			if (m_pendingNum.fetch_add(1, std::memory_order_relaxed) + 1 == cDeferredFreeWakeupThreshold)
+			{
+				m_wakeup.notify_one();
+			}
+
+			return true;
+		}
+
+		// Returns every queued block to the free list
+		void Flush()
+		{
+			LockGuard<TLock> guard(m_lock);
+
+			DrainDeferredFrees(std::numeric_limits<std::size_t>::max());
+		}
+
+		// Queued blocks are counted as used
+		std::size_t GetUsedSize() const override
+		{
+			return m_arena.GetUsedSize();
+		}
+
+		bool IsFullyMerged() const
+		{
+			return m_arena.IsFullyMerged();
+		}
+
+	private:
+		void MaintenanceLoop()
+		{
+			std::unique_lock<std::mutex> lock(m_wakeupMutex);
+
+			while (!m_stop)
+			{
+				m_wakeup.wait_for(lock, cMaintenanceInterval, [this](){
+					return m_stop || m_pendingNum.load(std::memory_order_relaxed) >= cDeferredFreeWakeupThreshold;
+				});
+
+				lock.unlock();
+
+				// Releases the arena lock between batches, so that allocations don't wait for the whole queue
+				while (m_pendingNum.load(std::memory_order_relaxed) > 0)
+				{
+					LockGuard<TLock> guard(m_lock);
+					if (DrainDeferredFrees(cDeferredFreeDrainBatchSize) == 0)
+					{
+						break;
+					}
+				}
+
+				lock.lock();
+			}
+		}
+
+		// Called under m_lock, which also makes the caller the single consumer of the queue
+		std::size_t DrainDeferredFrees(const std::size_t maxCount)
+		{
+			std::size_t count = 0;
+
+			while (count < maxCount)
+			{
+				MpscQueue::Node* node = m_deferredFrees.pop();
+				if (node == nullptr)
+				{
+					break;
+				}
+
+				m_arena.Free(node);
+				++count;
+			}
+
+			m_pendingNum.fetch_sub(count, std::memory_order_relaxed);
+			return count;
+		}
+
+	private:
+		FreeListAllocator<> m_arena;
+		TLock m_lock;
+		const bool m_deferred;
+
+		MpscQueue m_deferredFrees;
+		alignas(64) std::atomic<std::size_t> m_pendingNum{0};
+
+		std::mutex m_wakeupMutex;
+		std::condition_variable m_wakeup;
+		bool m_stop = false; // Guarded by m_wakeupMutex
+		std::thread m_maintenanceThread;
+	};
+} // namespace MemAlloc
@@ -0,0 +1,123 @@
+#include "DeferredFreeListAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace MemAlloc;
+
+static void RunTest()
+{
+	constexpr std::size_t threadsNum = 4;
+
+	std::cout << "StartMultiThreadTest: DeferredFreeListAllocator\n";
+	std::cout << "Desc: Create " << threadsNum << " threads. Each thread allocates chunks(MaxChunksNum / " << threadsNum << ") of size = 'rand() % sMaxChunkSize + 1', marks them and deallocates in random order. The background thread returns the chunks to the free list.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
+
+	DeferredFreeListAllocator<> allocator(sMaxChunksNum * sMaxChunkSize);
+	allocator.Init();
+
+	std::atomic<bool> corrupted{false};
+
+	auto threadFunc = [&allocator, &corrupted](const std::size_t threadIdx){
+		std::vector<void*> memPointers;
+		memPointers.reserve(sMaxChunksNum / threadsNum);
+
+		for (std::size_t i = 0; i < sMaxChunksNum / threadsNum; ++i)
+		{
+			auto* p = static_cast<std::size_t*>(allocator.Allocate(rand() % sMaxChunkSize + 1));
+			*p = threadIdx;
+			memPointers.emplace_back(p);
+		}
+
+		const std::size_t memPointersNum = memPointers.size();
+		for (int i = static_cast<int>(memPointersNum) - 1; i >= 0; --i)
+		{
+			const auto idx = (i != 0 ? rand() % i : 0);
+			if (*static_cast<std::size_t*>(memPointers[idx]) != threadIdx)
+			{
+				corrupted = true;
+			}
+			allocator.Free(memPointers[idx]);
+			memPointers.erase(memPointers.begin() + idx);
+		}
+	};
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < threadsNum; ++i)
+	{
+		threads.emplace_back(threadFunc, i);
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	allocator.Flush();
+	if (allocator.GetUsedSize() > 0 || !allocator.IsFullyMerged() || corrupted)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("DeferredFreeList4T", duration);
+}
+
+TEST_REGISTER(DeferredFreeListAllocatorTest, RunTest);
+
+// Keeps range(0) blocks of random size live and replaces a random one per iteration, timing every Free.
+// The more blocks are live, the more fragmented the heap is and the sooner the free blocks table fills up.
+template <bool Deferred>
+static void BM_FreeListFreeLatency(benchmark::State& state)
+{
+	const std::size_t blocksNum = static_cast<std::size_t>(state.range(0));
+
+	DeferredFreeListAllocator<> allocator(blocksNum * sMaxChunkSize, Deferred);
+	allocator.Init();
+
+	std::vector<void*> memPointers(blocksNum);
+	for (auto& p : memPointers)
+	{
+		p = allocator.Allocate(rand() % (sMaxChunkSize / 2) + 1);
+	}
+
+	std::vector<long long> freeLatencies;
+	freeLatencies.reserve(1 << 20);
+
+	for (auto _ : state)
+	{
+		void*& p = memPointers[rand() % blocksNum];
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		allocator.Free(p);
+		const auto finish = std::chrono::high_resolution_clock::now();
+
+		freeLatencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count());
+
+		p = allocator.Allocate(rand() % (sMaxChunkSize / 2) + 1);
+	}
+
+	std::sort(freeLatencies.begin(), freeLatencies.end());
+
+	state.SetItemsProcessed(state.iterations());
+	state.counters["free_p50_ns"] = static_cast<double>(freeLatencies[freeLatencies.size() / 2]);
+	state.counters["free_p99_ns"] = static_cast<double>(freeLatencies[freeLatencies.size() * 99 / 100]);
+	state.counters["free_p999_ns"] = static_cast<double>(freeLatencies[freeLatencies.size() * 999 / 1000]);
+	state.counters["free_max_ns"] = static_cast<double>(freeLatencies.back());
+}
+
+BENCHMARK_TEMPLATE(BM_FreeListFreeLatency, false)->Arg(256)->Arg(1024)->Arg(1536);
+BENCHMARK_TEMPLATE(BM_FreeListFreeLatency, true)->Arg(256)->Arg(1024)->Arg(1536);
\ No newline at end of file
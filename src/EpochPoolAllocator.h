@@ -0,0 +1,414 @@
+#pragma once
+
+#include "PoolAllocator.h"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace MemAlloc
+{
+	constexpr std::size_t cEpochRetireBatchSize = 64;
+	constexpr std::size_t cEpochAllocateRetries = 64;
+	constexpr std::size_t cEpochAllocateSleepUs = 50;
+
+	// Pool allocator with epoch-based reclamation for lock-free data structures.
+	// Readers access shared chunks only inside an EpochCriticalSection. Free() doesn't return a chunk to the pool
+	// right away but retires it: chunks are collected per thread and moved in batches to the limbo list of the epoch
+	// they were retired in. The global epoch advances once every thread in a critical section has observed it,
+	// and the chunks retired two epochs ago go back to the pool in a batch, since no reader can still hold them.
+	class EpochPoolAllocator final : public AllocatorInterface
+	{
+		static constexpr std::uint64_t cQuiescent = 0;
+		static constexpr std::size_t cLimboListsNum = 3;
+
+		struct LimboList
+		{
+			Spinlock m_lock;
+			std::uint64_t m_epoch = 0;
+			std::vector<void*> m_chunks;
+		};
+
+		struct alignas(64) ThreadRecord
+		{
+			std::atomic<std::uint64_t> m_epoch{cQuiescent}; // Epoch observed when the thread entered its critical section
+			std::size_t m_nestingDepth = 0;
+			std::uint64_t m_retiredEpoch = 0;
+			std::size_t m_retiredNum = 0;
+			void* m_retired[cEpochRetireBatchSize];
+			ThreadRecord* m_next = nullptr;
+			EpochPoolAllocator* m_owner = nullptr; // Guarded by GetRegistryMutex()
+			std::size_t m_ownerId = 0;
+			bool m_inUse = true; // Guarded by GetRegistryMutex()
+		};
+
+		// Releases the records of the current thread when it exits
+		struct ThreadRecords
+		{
+			~ThreadRecords()
+			{
+				std::lock_guard<std::mutex> lock(GetRegistryMutex());
+
+				for (auto* record : m_records)
+				{
+					if (record->m_owner == nullptr)
+					{
+						delete record;
+					}
+					else
+					{
+						record->m_owner->FlushRetired(record);
+						record->m_inUse = false;
+					}
+				}
+
+				GetLastRecord() = nullptr;
+			}
+
+			std::vector<ThreadRecord*> m_records;
+		};
+
+	public:
+		EpochPoolAllocator() = delete;
+		EpochPoolAllocator(const EpochPoolAllocator&) = delete;
+
+		EpochPoolAllocator(const std::size_t chunksNum, const std::size_t chunkSize)
+			: AllocatorInterface(chunksNum * chunkSize), m_pool(chunksNum, chunkSize), m_id(GetNextId())
+		{
+		}
+
+		~EpochPoolAllocator() override
+		{
+			// Records of the threads that are still alive are released by those threads
+			std::lock_guard<std::mutex> lock(GetRegistryMutex());
+
+			ThreadRecord* record = m_records.load(std::memory_order_acquire);
+			while (record != nullptr)
+			{
+				ThreadRecord* next = record->m_next;
+
+				if (record->m_inUse)
+				{
+					record->m_owner = nullptr;
+				}
+				else
+				{
+					delete record;
+				}
+
+				record = next;
+			}
+		}
+
+		// Must be called before any thread starts allocating
+		void Init() override
+		{
+			m_pool.Init();
+		}
+
+		// When the pool is empty, waits for the readers that hold back the retired chunks
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			for (std::size_t i = 0; i < cEpochAllocateRetries; ++i)
+			{
+				void* dataAddress = TryAllocate(size, alignment);
+				if (dataAddress != nullptr)
+				{
+					return dataAddress;
+				}
+
+				// Lets the readers that hold back the current epoch leave their critical sections
+				std::this_thread::sleep_for(std::chrono::microseconds(cEpochAllocateSleepUs));
+			}
+
+			return m_pool.Allocate(size, alignment);
+		}
+
+		// Same as Allocate but returns nullptr when the pool is empty and no retired chunk can be reclaimed yet
+		void* TryAllocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t))
+		{
+			void* dataAddress = m_pool.TryAllocate(size, alignment);
+			if (dataAddress != nullptr)
+			{
+				return dataAddress;
+			}
+
+			FlushRetired(GetThreadRecord());
+
+			// The chunks retired in the current epoch become safe two epochs later
+			if (TryAdvanceEpoch())
+			{
+				TryAdvanceEpoch();
+			}
+			ReclaimLimboLists();
+
+			return m_pool.TryAllocate(size, alignment);
+		}
+
+		// Retires the chunk. It goes back to the pool once no critical section can still reference it.
+		bool Free(void* ptr) override
+		{
+			if (!m_pool.Contains(ptr))
+			{
+				return false;
+			}
+
+			ThreadRecord* record = GetThreadRecord();
+			const std::uint64_t epoch = m_globalEpoch.load(std::memory_order_acquire);
+
+			if (record->m_retiredNum > 0 && record->m_retiredEpoch != epoch)
+			{
+				FlushRetired(record);
+			}
+
+			record->m_retiredEpoch = epoch;
+			record->m_retired[record->m_retiredNum++] = ptr;
+
+			if (record->m_retiredNum == cEpochRetireBatchSize)
+			{
+				FlushRetired(record);
+
+				if (TryAdvanceEpoch())
+				{
+					ReclaimLimboLists();
+				}
+			}
+
+			return true;
+		}
+
+		// Critical sections may nest
+		void EnterCriticalSection()
+		{
+			ThreadRecord* record = GetThreadRecord();
+
+			if (record->m_nestingDepth++ == 0)
+			{
+				record->m_epoch.store(m_globalEpoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+				// The epoch must be visible to other threads before the thread reads any shared chunk
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			}
+		}
+
+		void ExitCriticalSection()
+		{
+			ThreadRecord* record = GetThreadRecord();
+			assert(record->m_nestingDepth > 0 && "Not in a critical section");
+
+			if (--record->m_nestingDepth == 0)
+			{
+				record->m_epoch.store(cQuiescent, std::memory_order_release);
+			}
+		}
+
+		// Returns every retired chunk to the pool. Must not run concurrently with any other method.
+		void FreeAllRetired()
+		{
+			for (ThreadRecord* record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->m_next)
+			{
+				m_pool.FreeBatch(record->m_retired, record->m_retiredNum);
+				record->m_retiredNum = 0;
+			}
+
+			for (auto& limboList : m_limboLists)
+			{
+				m_pool.FreeBatch(limboList.m_chunks.data(), limboList.m_chunks.size());
+				limboList.m_chunks.clear();
+			}
+		}
+
+		// Retired chunks are counted as used
+		std::size_t GetUsedSize() const override
+		{
+			return m_pool.GetUsedSize();
+		}
+
+		std::size_t GetChunkSize() const
+		{
+			return m_pool.GetChunkSize();
+		}
+
+		std::uint64_t GetEpoch() const
+		{
+			return m_globalEpoch.load(std::memory_order_relaxed);
+		}
+
+	private:
+		// Advances the global epoch if every thread in a critical section has observed the current one
+		bool TryAdvanceEpoch()
+		{
+			std::uint64_t epoch = m_globalEpoch.load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			for (ThreadRecord* record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->m_next)
+			{
+				const std::uint64_t recordEpoch = record->m_epoch.load(std::memory_order_acquire);
+				if (recordEpoch != cQuiescent && recordEpoch != epoch)
+				{
+					return false;
+				}
+			}
+
+			return m_globalEpoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel, std::memory_order_relaxed);
+		}
+
+		// Moves the chunks retired by the thread to the limbo list of their epoch
+		void FlushRetired(ThreadRecord* record)
+		{
+			const std::uint64_t epoch = record->m_retiredEpoch;
+			LimboList& limboList = m_limboLists[epoch % cLimboListsNum];
+
+			SpinlockGuard guard(limboList.m_lock);
+
+			// The list still holds the chunks of epoch 'epoch - 3' or older, which are safe by now.
+			// A list of a newer epoch keeps the chunks longer than necessary, which is still safe.
+			if (limboList.m_epoch < epoch)
+			{
+				m_pool.FreeBatch(limboList.m_chunks.data(), limboList.m_chunks.size());
+				limboList.m_chunks.clear();
+				limboList.m_epoch = epoch;
+			}
+
+			limboList.m_chunks.insert(limboList.m_chunks.end(), record->m_retired, record->m_retired + record->m_retiredNum);
+			record->m_retiredNum = 0;
+		}
+
+		// Chunks retired in epoch 'e' may be referenced by critical sections of epochs 'e - 1' and 'e',
+		// which are all over once the global epoch reaches 'e + 2'
+		void ReclaimLimboLists()
+		{
+			const std::uint64_t globalEpoch = m_globalEpoch.load(std::memory_order_acquire);
+
+			for (auto& limboList : m_limboLists)
+			{
+				SpinlockGuard guard(limboList.m_lock);
+
+				if (!limboList.m_chunks.empty() && limboList.m_epoch + 2 <= globalEpoch)
+				{
+					m_pool.FreeBatch(limboList.m_chunks.data(), limboList.m_chunks.size());
+					limboList.m_chunks.clear();
+				}
+			}
+		}
+
+		ThreadRecord* GetThreadRecord()
+		{
+			ThreadRecord* record = GetLastRecord();
+			if (record != nullptr && record->m_ownerId == m_id)
+			{
+				return record;
+			}
+
+			return FindOrCreateThreadRecord();
+		}
+
+		ThreadRecord* FindOrCreateThreadRecord()
+		{
+			auto& records = GetThreadRecords().m_records;
+
+			for (auto* record : records)
+			{
+				if (record->m_ownerId == m_id)
+				{
+					GetLastRecord() = record;
+					return record;
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(GetRegistryMutex());
+
+			// Drop the records of destroyed allocators
+			for (auto it = records.begin(); it != records.end();)
+			{
+				if ((*it)->m_owner == nullptr)
+				{
+					delete *it;
+					it = records.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+
+			// Reuse the record of an exited thread, if any
+			ThreadRecord* record = m_records.load(std::memory_order_acquire);
+			while (record != nullptr && record->m_inUse)
+			{
+				record = record->m_next;
+			}
+
+			if (record != nullptr)
+			{
+				record->m_inUse = true;
+			}
+			else
+			{
+				record = new ThreadRecord();
+				record->m_owner = this;
+				record->m_ownerId = m_id;
+				record->m_next = m_records.load(std::memory_order_relaxed);
+				m_records.store(record, std::memory_order_release);
+			}
+
+			records.push_back(record);
+
+			GetLastRecord() = record;
+			return record;
+		}
+
+		static std::size_t GetNextId()
+		{
+			static std::atomic<std::size_t> sNextId{1};
+			return sNextId.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		static std::mutex& GetRegistryMutex()
+		{
+			static std::mutex sRegistryMutex;
+			return sRegistryMutex;
+		}
+
+		static ThreadRecords& GetThreadRecords()
+		{
+			static thread_local ThreadRecords sThreadRecords;
+			return sThreadRecords;
+		}
+
+		static ThreadRecord*& GetLastRecord()
+		{
+			static thread_local ThreadRecord* sLastRecord = nullptr;
+			return sLastRecord;
+		}
+
+	private:
+		PoolAllocator<Spinlock> m_pool;
+		const std::size_t m_id;
+		std::atomic<std::uint64_t> m_globalEpoch{1};
+		LimboList m_limboLists[cLimboListsNum];
+		std::atomic<ThreadRecord*> m_records{nullptr}; // Records are only added, under GetRegistryMutex()
+	};
+
+	// Read-side critical section of an EpochPoolAllocator
+	class EpochCriticalSection final
+	{
+	public:
+		explicit EpochCriticalSection(EpochPoolAllocator& allocator) : m_allocator(allocator)
+		{
+			m_allocator.EnterCriticalSection();
+		}
+
+		EpochCriticalSection(const EpochCriticalSection&) = delete;
+		EpochCriticalSection& operator=(const EpochCriticalSection&) = delete;
+
+		~EpochCriticalSection()
+		{
+			m_allocator.ExitCriticalSection();
+		}
+
+	private:
+		EpochPoolAllocator& m_allocator;
+	};
+} // namespace MemAlloc
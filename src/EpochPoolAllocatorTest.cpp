@@ -0,0 +1,221 @@
+#include "EpochPoolAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+using namespace MemAlloc;
+
+namespace
+{
+	// A node of a lock-free structure. A reader that sees different stamps reads a chunk that was already reused.
+	struct Node
+	{
+		std::atomic<std::size_t> m_firstStamp;
+		std::atomic<std::size_t> m_secondStamp;
+	};
+
+	constexpr std::size_t cSlotsNum = 16;
+
+	Node* CreateNode(AllocatorInterface& allocator, const std::size_t stamp)
+	{
+		auto* node = static_cast<Node*>(allocator.Allocate(sizeof(Node)));
+		node->m_firstStamp.store(stamp, std::memory_order_relaxed);
+		node->m_secondStamp.store(stamp, std::memory_order_relaxed);
+		return node;
+	}
+
+	bool IsNodeValid(const Node* node)
+	{
+		const std::size_t firstStamp = node->m_firstStamp.load(std::memory_order_relaxed);
+		return node->m_secondStamp.load(std::memory_order_relaxed) == firstStamp;
+	}
+}
+
+static void RunTest()
+{
+	constexpr std::size_t readersNum = 3;
+	constexpr std::size_t writersNum = 2;
+	constexpr std::size_t updatesNum = 20000;
+
+	std::cout << "StartMultiThreadTest: EpochPoolAllocator\n";
+	std::cout << "Desc: Creates an epoch pool allocator and " << cSlotsNum << " shared slots. " << writersNum << " threads replace the nodes in the slots(" << updatesNum << " times each) and free the old ones, while " << readersNum << " threads read the nodes inside critical sections.\n";
+
+	EpochPoolAllocator allocator(sMaxChunksNum, 64);
+	allocator.Init();
+
+	std::array<std::atomic<Node*>, cSlotsNum> slots;
+	for (std::size_t i = 0; i < cSlotsNum; ++i)
+	{
+		slots[i].store(CreateNode(allocator, i), std::memory_order_relaxed);
+	}
+
+	std::atomic<bool> corrupted{false};
+	std::atomic<std::size_t> writersDone{0};
+
+	auto readerFunc = [&](){
+		while (writersDone.load(std::memory_order_acquire) < writersNum)
+		{
+			EpochCriticalSection criticalSection(allocator);
+
+			for (auto& slot : slots)
+			{
+				if (!IsNodeValid(slot.load(std::memory_order_acquire)))
+				{
+					corrupted = true;
+				}
+			}
+		}
+	};
+
+	auto writerFunc = [&](const std::size_t writerIdx){
+		for (std::size_t i = 0; i < updatesNum; ++i)
+		{
+			Node* node = CreateNode(allocator, (writerIdx + 1) * updatesNum + i);
+			Node* oldNode = slots[rand() % cSlotsNum].exchange(node, std::memory_order_acq_rel);
+			allocator.Free(oldNode);
+		}
+
+		++writersDone;
+	};
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < readersNum; ++i)
+	{
+		threads.emplace_back(readerFunc);
+	}
+	for (std::size_t i = 0; i < writersNum; ++i)
+	{
+		threads.emplace_back(writerFunc, i);
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	for (auto& slot : slots)
+	{
+		allocator.Free(slot.load(std::memory_order_relaxed));
+	}
+	allocator.FreeAllRetired();
+
+	if (allocator.GetUsedSize() > 0 || corrupted || allocator.GetEpoch() == 1)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("EpochPool5T       ", duration);
+}
+
+TEST_REGISTER(EpochPoolAllocatorTest, RunTest);
+
+// Read-heavy workload: every thread reads a slot and replaces one node per 'range(0)' reads
+static EpochPoolAllocator* sEpochPool = nullptr;
+static std::array<std::atomic<Node*>, cSlotsNum> sEpochSlots;
+
+static void BM_EpochPoolReadMostly(benchmark::State& state)
+{
+	if (state.thread_index() == 0)
+	{
+		sEpochPool = new EpochPoolAllocator(sMaxChunksNum, 64);
+		sEpochPool->Init();
+
+		for (std::size_t i = 0; i < cSlotsNum; ++i)
+		{
+			sEpochSlots[i].store(CreateNode(*sEpochPool, i), std::memory_order_relaxed);
+		}
+	}
+
+	const std::size_t readsPerWrite = static_cast<std::size_t>(state.range(0));
+	std::size_t i = 0;
+
+	for (auto _ : state)
+	{
+		auto& slot = sEpochSlots[++i % cSlotsNum];
+
+		if (i % readsPerWrite == 0)
+		{
+			Node* oldNode = slot.exchange(CreateNode(*sEpochPool, i), std::memory_order_acq_rel);
+			sEpochPool->Free(oldNode);
+		}
+		else
+		{
+			EpochCriticalSection criticalSection(*sEpochPool);
+			benchmark::DoNotOptimize(IsNodeValid(slot.load(std::memory_order_acquire)));
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations());
+
+	if (state.thread_index() == 0)
+	{
+		delete sEpochPool;
+		sEpochPool = nullptr;
+	}
+}
+
+BENCHMARK(BM_EpochPoolReadMostly)->Arg(16)->Arg(128)->ThreadRange(1, 16)->UseRealTime();
+
+// The same workload with readers and Free() serialized by a mutex
+static PoolAllocator<Spinlock>* sMutexPool = nullptr;
+static std::array<std::atomic<Node*>, cSlotsNum> sMutexSlots;
+static std::mutex sMutexSlotsMutex;
+
+static void BM_MutexPoolReadMostly(benchmark::State& state)
+{
+	if (state.thread_index() == 0)
+	{
+		sMutexPool = new PoolAllocator<Spinlock>(sMaxChunksNum, 64);
+		sMutexPool->Init();
+
+		for (std::size_t i = 0; i < cSlotsNum; ++i)
+		{
+			sMutexSlots[i].store(CreateNode(*sMutexPool, i), std::memory_order_relaxed);
+		}
+	}
+
+	const std::size_t readsPerWrite = static_cast<std::size_t>(state.range(0));
+	std::size_t i = 0;
+
+	for (auto _ : state)
+	{
+		auto& slot = sMutexSlots[++i % cSlotsNum];
+
+		if (i % readsPerWrite == 0)
+		{
+			Node* node = CreateNode(*sMutexPool, i);
+
+			std::lock_guard<std::mutex> lock(sMutexSlotsMutex);
+			sMutexPool->Free(slot.exchange(node, std::memory_order_acq_rel));
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(sMutexSlotsMutex);
+			benchmark::DoNotOptimize(IsNodeValid(slot.load(std::memory_order_acquire)));
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations());
+
+	if (state.thread_index() == 0)
+	{
+		delete sMutexPool;
+		sMutexPool = nullptr;
+	}
+}
+
+BENCHMARK(BM_MutexPoolReadMostly)->Arg(16)->Arg(128)->ThreadRange(1, 16)->UseRealTime();
\ No newline at end of file
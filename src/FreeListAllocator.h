@@ -1,38 +1,49 @@
 #pragma once
 #include "AllocatorInterface.h"
+#include "BestFitSearch.h"
+#include <algorithm>
 #include <cassert>
 #include <array>
+#include <limits>
 
 namespace MemAlloc
 {
-	enum MergePolicy
-	{
-		ENABLE_FAST_MERGE = 1,
-		ENABLE_FULL_MERGE = 2,
-		ENABLE_FULL_MERGE_IF_NO_SPACE = 3
-	};
-	const MergePolicy cMergePolicy(ENABLE_FULL_MERGE_IF_NO_SPACE);
-
-	const ThreadPolicy cFreeListThreadPolicy(NONE);
-
 	constexpr std::size_t cL1Size = 32768; // 32KiB
 	constexpr std::size_t cL1DSize = 2*cL1Size; // 64KiB
 	constexpr std::size_t cFreeMemBlocksSize = cL1Size;
 
+	// Blocks carry boundary tags. The header of every block holds its size, whether it is free and whether the
+	// previous block is free. A free block also keeps the index of its table entry after the header and
+	// repeats its size in a footer, so Free() finds both physical neighbours and their entries in O(1) and merges
+	// with them right away: two free blocks are never adjacent.
+	// When the table is full, further free blocks spill into an intrusive doubly linked list threaded through the
+	// blocks themselves, so heavy fragmentation only slows the search down instead of failing Free(). A slot that
+	// frees up in the table is refilled from the spill list.
+	// TLock is the locking policy of the instance, NoLock by default (see AllocatorInterface.h)
+	template <class TLock = NoLock>
 	class alignas(sizeof(std::size_t)) FreeListAllocator : public AllocatorInterface
 	{
 		struct alignas(sizeof(std::size_t)) AllocationHeader
 		{
-			std::size_t blockSize;
+			std::size_t blockSize; // The block flags are kept in the low bits
 		};
 
 		static const std::size_t cAllocationHeaderSize = sizeof(AllocationHeader);
+		static constexpr std::size_t cBlockFreeFlag = 1;
+		static constexpr std::size_t cPrevBlockFreeFlag = 2;
+		static constexpr std::size_t cBlockSpilledFlag = 4; // The free block is in the spill list, not in the table
+		static constexpr std::size_t cBlockFlagsMask = cBlockFreeFlag | cPrevBlockFreeFlag | cBlockSpilledFlag;
+		// A spilled free block holds the header, the next and prev links and the footer
+		static constexpr std::size_t cMinBlockSize = 4 * sizeof(std::size_t);
+		static constexpr std::size_t cNoBlock = std::numeric_limits<std::size_t>::max();
+
+		static_assert(cBlockFlagsMask < sizeof(std::size_t), "Block sizes are multiples of the word size");
 
 	public:
 		FreeListAllocator(FreeListAllocator& freeListAllocator) = delete;
 
 		FreeListAllocator(const std::size_t totalSize)
-			: AllocatorInterface(totalSize)
+			: AllocatorInterface(totalSize / sizeof(std::size_t) * sizeof(std::size_t))
 		{
 		}
 
@@ -55,217 +66,377 @@ namespace MemAlloc
 			Reset();
 		}
 
-		struct alignas(sizeof(std::size_t)) MemBlock
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
 		{
-			std::size_t memBlockOffset = 0;
-			std::size_t blockSize = 0;
-		};
+			void* resultPtr = TryAllocate(size, alignment);
+			assert(resultPtr != nullptr && "Not enough memory");
 
-		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+			return resultPtr;
+		}
+
+		// Same as Allocate but returns nullptr when there is no block to fit the size
+		void* TryAllocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t))
 		{
 			// Search through the free list for a free block that has enough space to allocate our data
 
+			assert(alignment % sizeof(std::size_t) == 0 && "Alignment must be a multiple of the header size");
+
 			const std::size_t padding = alignment - (cAllocationHeaderSize + size) % alignment;
-			const std::size_t requiredSize = cAllocationHeaderSize + static_cast<uint32_t>(size) + padding;
+			std::size_t requiredSize = std::max(cAllocationHeaderSize + size + padding,
+			                                    (cMinBlockSize + alignment - 1) / alignment * alignment);
 
-			switch (cFreeListThreadPolicy)
-			{
-			case ENABLE_SPIN_LOCK:
-				m_spinlock.lock();
-				break;
-			case NONE:
-				break;
-			}
+			LockGuard<TLock> guard(m_lock);
+
+			std::size_t memBlockOffset = 0;
+			std::size_t blockSize = 0;
 
 			const int freeMemBlockIndex = FindFreeMemBlockIndex(requiredSize);
-			assert(freeMemBlockIndex != -1 && "Not enough memory");
-			if (freeMemBlockIndex == -1)
+			if (freeMemBlockIndex != -1)
 			{
-				return nullptr;
+				memBlockOffset = m_freeBlockOffsets[freeMemBlockIndex];
+				blockSize = m_freeBlockSizes[freeMemBlockIndex];
+			}
+			else
+			{
+				memBlockOffset = FindSpilledMemBlockOffset(requiredSize);
+				if (memBlockOffset == cNoBlock)
+				{
+					return nullptr;
+				}
+				blockSize = GetBlockSize(memBlockOffset);
 			}
 
-			const std::size_t restSize = m_freeMemBlocks[freeMemBlockIndex].blockSize - requiredSize;
-			void* freeMemBlock = m_start_ptr + m_freeMemBlocks[freeMemBlockIndex].memBlockOffset;
+			const std::size_t restSize = blockSize - requiredSize;
 
-			if (restSize > 0)
+			if (restSize >= cMinBlockSize && freeMemBlockIndex != -1)
 			{
-				m_freeMemBlocks[freeMemBlockIndex] = {
-					(m_freeMemBlocks[freeMemBlockIndex].memBlockOffset +
-						static_cast<uint32_t>(requiredSize)),
-					static_cast<uint32_t>(restSize)
-				};
+				m_freeBlockOffsets[freeMemBlockIndex] = memBlockOffset + requiredSize;
+				m_freeBlockSizes[freeMemBlockIndex] = restSize;
+				WriteFreeBlockTags(freeMemBlockIndex);
 			}
 			else
 			{
-				std::swap(m_freeMemBlocks[freeMemBlockIndex - 1], m_freeMemBlocks[m_currSize]);
-				--m_currSize;
+				RemoveFreeBlock(memBlockOffset);
+
+				if (restSize >= cMinBlockSize)
+				{
+					InsertFreeBlock(memBlockOffset + requiredSize, restSize);
+				}
+				else
+				{
+					// The rest is too small to hold the tags of a free block, it goes with the allocation
+					requiredSize = blockSize;
+					SetPrevBlockFree(memBlockOffset + requiredSize, false);
+				}
 			}
 
-			// Setup data block
-			AllocationHeader* allocationHeader = static_cast<AllocationHeader*>(freeMemBlock);
+			// Setup data block. The previous block of a free block is never free.
+			AllocationHeader* allocationHeader = GetHeader(memBlockOffset);
+			allocationHeader->blockSize = requiredSize;
 
 			void* resultPtr = (PTR_TO_CHAR(allocationHeader) + cAllocationHeaderSize);
 			assert(PTR_TO_INT(resultPtr) % alignment == 0 && "Data address must be aligment");
 
 			m_used += requiredSize;
 
-			allocationHeader->blockSize = requiredSize;
-
-			switch (cFreeListThreadPolicy)
-			{
-			case ENABLE_SPIN_LOCK:
-				m_spinlock.unlock();
-				break;
-			case NONE:
-				break;
-			}
-
 			return resultPtr;
 		}
 
 		bool Free(void* ptr) override
 		{
-			// Insert it in a sorted position by the address number
-
 			AllocationHeader* allocationHeader = reinterpret_cast<AllocationHeader*>(PTR_TO_CHAR(ptr) -
 				cAllocationHeaderSize);
 
-			const MemBlock freeMemBlock{
-				static_cast<uint32_t>(reinterpret_cast<char*>(allocationHeader) - m_start_ptr), 0
-			};
+			const std::size_t memBlockOffset = static_cast<std::size_t>(PTR_TO_CHAR(allocationHeader) - m_start_ptr);
 
-			switch (cFreeListThreadPolicy)
-			{
-			case ENABLE_SPIN_LOCK:
-				m_spinlock.lock();
-				break;
-			case NONE:
-				break;
-			}
+			LockGuard<TLock> guard(m_lock);
 
-			assert(!ShouldFullMerge() && "There is no free space for free a memory block!");
-			if (ShouldFullMerge())
-			{
-				return false;
-			}			
+			assert((allocationHeader->blockSize & cBlockFreeFlag) == 0 && "Double free");
 
-			m_freeMemBlocks[m_currSize] = freeMemBlock;
-			++m_currSize;
+			const std::size_t blockSize = allocationHeader->blockSize & ~cBlockFlagsMask;
+			const bool isPrevFree = (allocationHeader->blockSize & cPrevBlockFreeFlag) != 0;
+			const std::size_t nextOffset = memBlockOffset + blockSize;
+			const bool isNextFree = nextOffset < m_totalSize && (GetHeader(nextOffset)->blockSize & cBlockFreeFlag) != 0;
 
-			m_freeMemBlocks[m_currSize - 1].blockSize = allocationHeader->blockSize;
-			m_used -= m_freeMemBlocks[m_currSize - 1].blockSize;
+			m_used -= blockSize;
 
-			// Merge contiguous memBlocks
-
-			switch (cMergePolicy)
+			std::size_t mergedSize = blockSize;
+			if (isNextFree)
 			{
-			case ENABLE_FAST_MERGE:
-				FastMergeMemBlocks(static_cast<int>(m_currSize) - 1);
-				break;
-			case ENABLE_FULL_MERGE:
-				FullMergeMemBlocks();
-				break;
-			case ENABLE_FULL_MERGE_IF_NO_SPACE:
-				if (ShouldFullMerge())
-				{
-					FullMergeMemBlocks();
-				}
-				break;
+				mergedSize += GetBlockSize(nextOffset);
+				RemoveFreeBlock(nextOffset);
 			}
 
-			switch (cFreeListThreadPolicy)
+			// The previous block keeps its place in the table or in the spill list
+			if (isPrevFree)
+			{
+				const std::size_t prevOffset = memBlockOffset - GetFooter(memBlockOffset);
+				ResizeFreeBlock(prevOffset, GetBlockSize(prevOffset) + mergedSize);
+			}
+			else
 			{
-			case ENABLE_SPIN_LOCK:
-				m_spinlock.unlock();
-				break;
-			case NONE:
-				break;
+				InsertFreeBlock(memBlockOffset, mergedSize);
 			}
 
+			SetPrevBlockFree(memBlockOffset + mergedSize, true);
+
 			return true;
 		}
 
 		void Reset()
 		{
+			LockGuard<TLock> guard(m_lock);
+
 			m_used = 0;
-			m_freeMemBlocks[0] = {0, static_cast<uint32_t>(m_totalSize)};
+			m_freeBlockOffsets[0] = 0;
+			m_freeBlockSizes[0] = m_totalSize;
 			m_currSize = 1;
+			m_spilledHead = cNoBlock;
+			m_spilledNum = 0;
+			WriteFreeBlockTags(0);
 		}
 
-		void FullMergeMemBlocks()
+		bool Contains(const void* ptr) const
 		{
-			for (int i = static_cast<int>(m_currSize) - 1; i >= 0; --i)
-			{
-				FastMergeMemBlocks(i);
-			}
+			return ptr >= m_start_ptr && ptr < m_start_ptr + m_totalSize;
+		}
+
+		// Counts the free blocks of the table and of the spill list
+		std::size_t GetFreeMemBlocksNum() const
+		{
+			return m_currSize + m_spilledNum;
+		}
+
+		std::size_t GetFreeMemBlocksCapacity() const
+		{
+			return m_freeBlockSizes.size();
+		}
+
+		std::size_t GetSpilledMemBlocksNum() const
+		{
+			return m_spilledNum;
+		}
+
+		// Must be called after Init and before any block is allocated
+		void FirstTouch()
+		{
+			TouchPages(m_start_ptr, m_totalSize);
+
+			// The touch overwrites the tags of the only free block
+			Reset();
 		}
 
 		bool IsFullyMerged() const
 		{
-			return m_currSize == 1 && m_freeMemBlocks[0].memBlockOffset == 0 && m_freeMemBlocks[0].blockSize ==
-				m_totalSize;
+			return m_currSize == 1 && m_spilledNum == 0 && m_freeBlockOffsets[0] == 0 && m_freeBlockSizes[0] == m_totalSize;
 		}
 
 	private:
-		bool ShouldFullMerge() const
+		AllocationHeader* GetHeader(const std::size_t memBlockOffset) const
 		{
-			return m_currSize == m_freeMemBlocks.size();
+			return reinterpret_cast<AllocationHeader*>(m_start_ptr + memBlockOffset);
 		}
 
-		void FastMergeMemBlocks(const int pivotIndex)
+		std::size_t& GetWord(const std::size_t offset) const
 		{
-			const auto& pivotMemBlock = m_freeMemBlocks[pivotIndex];
+			return *reinterpret_cast<std::size_t*>(m_start_ptr + offset);
+		}
+
+		std::size_t GetBlockSize(const std::size_t memBlockOffset) const
+		{
+			return GetHeader(memBlockOffset)->blockSize & ~cBlockFlagsMask;
+		}
 
-			for (int i = pivotIndex - 1; i >= 0; --i)
+		// The footer of the block that ends at the offset
+		std::size_t& GetFooter(const std::size_t memBlockEndOffset) const
+		{
+			return GetWord(memBlockEndOffset - sizeof(std::size_t));
+		}
+
+		// The index of the entry of a free block is stored right after its header
+		std::size_t& GetMemBlockIndex(const std::size_t memBlockOffset) const
+		{
+			return GetWord(memBlockOffset + cAllocationHeaderSize);
+		}
+
+		// A spilled block keeps its links where a table block keeps its index
+		std::size_t& GetSpilledNext(const std::size_t memBlockOffset) const
+		{
+			return GetWord(memBlockOffset + cAllocationHeaderSize);
+		}
+
+		std::size_t& GetSpilledPrev(const std::size_t memBlockOffset) const
+		{
+			return GetWord(memBlockOffset + cAllocationHeaderSize + sizeof(std::size_t));
+		}
+
+		bool IsSpilled(const std::size_t memBlockOffset) const
+		{
+			return (GetHeader(memBlockOffset)->blockSize & cBlockSpilledFlag) != 0;
+		}
+
+		// Writes the header, the entry index and the footer of a free block
+		void WriteFreeBlockTags(const std::size_t index)
+		{
+			const std::size_t memBlockOffset = m_freeBlockOffsets[index];
+			const std::size_t blockSize = m_freeBlockSizes[index];
+
+			GetHeader(memBlockOffset)->blockSize = blockSize | cBlockFreeFlag;
+			GetMemBlockIndex(memBlockOffset) = index;
+			GetFooter(memBlockOffset + blockSize) = blockSize;
+		}
+
+		void SetPrevBlockFree(const std::size_t memBlockOffset, const bool isPrevFree)
+		{
+			if (memBlockOffset >= m_totalSize)
 			{
-				if (m_freeMemBlocks[i].memBlockOffset + m_freeMemBlocks[i].blockSize == pivotMemBlock.memBlockOffset)
-				{
-					m_freeMemBlocks[i].blockSize += pivotMemBlock.blockSize;
-					std::swap(m_freeMemBlocks[pivotIndex], m_freeMemBlocks[m_currSize - 1]);
-					--m_currSize;
-					return;
-				}
+				return;
+			}
 
-				if (m_freeMemBlocks[i].memBlockOffset == pivotMemBlock.memBlockOffset + pivotMemBlock.blockSize)
-				{
-					m_freeMemBlocks[i].memBlockOffset = pivotMemBlock.memBlockOffset;
-					m_freeMemBlocks[i].blockSize += pivotMemBlock.blockSize;
-					std::swap(m_freeMemBlocks[pivotIndex], m_freeMemBlocks[m_currSize - 1]);
-					--m_currSize;
-					return;
-				}
+			AllocationHeader* allocationHeader = GetHeader(memBlockOffset);
+			allocationHeader->blockSize = isPrevFree ? allocationHeader->blockSize | cPrevBlockFreeFlag
+			                                         : allocationHeader->blockSize & ~cPrevBlockFreeFlag;
+		}
+
+		// Puts the free block into the table, or into the spill list when the table is full
+		void InsertFreeBlock(const std::size_t memBlockOffset, const std::size_t blockSize)
+		{
+			if (m_currSize < m_freeBlockSizes.size())
+			{
+				m_freeBlockOffsets[m_currSize] = memBlockOffset;
+				m_freeBlockSizes[m_currSize] = blockSize;
+				++m_currSize;
+				WriteFreeBlockTags(m_currSize - 1);
+				return;
+			}
+
+			GetHeader(memBlockOffset)->blockSize = blockSize | cBlockFreeFlag | cBlockSpilledFlag;
+			GetSpilledNext(memBlockOffset) = m_spilledHead;
+			GetSpilledPrev(memBlockOffset) = cNoBlock;
+			GetFooter(memBlockOffset + blockSize) = blockSize;
+
+			if (m_spilledHead != cNoBlock)
+			{
+				GetSpilledPrev(m_spilledHead) = memBlockOffset;
+			}
+			m_spilledHead = memBlockOffset;
+			++m_spilledNum;
+		}
+
+		void RemoveFreeBlock(const std::size_t memBlockOffset)
+		{
+			if (IsSpilled(memBlockOffset))
+			{
+				UnlinkSpilledBlock(memBlockOffset);
+			}
+			else
+			{
+				RemoveFreeMemBlock(GetMemBlockIndex(memBlockOffset));
+			}
+		}
+
+		// Changes the size of a free block that keeps its offset
+		void ResizeFreeBlock(const std::size_t memBlockOffset, const std::size_t blockSize)
+		{
+			if (IsSpilled(memBlockOffset))
+			{
+				GetHeader(memBlockOffset)->blockSize = blockSize | cBlockFreeFlag | cBlockSpilledFlag;
+				GetFooter(memBlockOffset + blockSize) = blockSize;
+			}
+			else
+			{
+				const std::size_t index = GetMemBlockIndex(memBlockOffset);
+				m_freeBlockSizes[index] = blockSize;
+				WriteFreeBlockTags(index);
 			}
 		}
 
+		// Moves the last entry to the index and updates the index stored in its block.
+		// The freed slot is refilled from the spill list.
+		void RemoveFreeMemBlock(const std::size_t index)
+		{
+			--m_currSize;
+			if (index != m_currSize)
+			{
+				m_freeBlockOffsets[index] = m_freeBlockOffsets[m_currSize];
+				m_freeBlockSizes[index] = m_freeBlockSizes[m_currSize];
+				GetMemBlockIndex(m_freeBlockOffsets[index]) = index;
+			}
+
+			if (m_spilledHead != cNoBlock)
+			{
+				const std::size_t memBlockOffset = m_spilledHead;
+				UnlinkSpilledBlock(memBlockOffset);
+
+				m_freeBlockOffsets[m_currSize] = memBlockOffset;
+				m_freeBlockSizes[m_currSize] = GetBlockSize(memBlockOffset);
+				++m_currSize;
+				WriteFreeBlockTags(m_currSize - 1);
+			}
+		}
+
+		void UnlinkSpilledBlock(const std::size_t memBlockOffset)
+		{
+			const std::size_t next = GetSpilledNext(memBlockOffset);
+			const std::size_t prev = GetSpilledPrev(memBlockOffset);
+
+			if (prev != cNoBlock)
+			{
+				GetSpilledNext(prev) = next;
+			}
+			else
+			{
+				m_spilledHead = next;
+			}
+
+			if (next != cNoBlock)
+			{
+				GetSpilledPrev(next) = prev;
+			}
+
+			--m_spilledNum;
+		}
+
 		int FindFreeMemBlockIndex(const std::size_t size) const
 		{
-			if (m_currSize == 0 || ShouldFullMerge() || m_used == m_totalSize)
+			if (m_currSize == 0 || m_used == m_totalSize)
 			{
 				return -1;
 			}
 
+			return FindBestFit(m_freeBlockSizes.data(), m_currSize, size);
+		}
+
+		// Best fit among the spilled blocks, only searched when no block of the table fits
+		std::size_t FindSpilledMemBlockOffset(const std::size_t size) const
+		{
 			std::size_t smallestDiff = std::numeric_limits<std::size_t>::max();
-			int bestIndex = -1;
+			std::size_t bestOffset = cNoBlock;
 
-			for (int i = static_cast<int>(m_currSize) - 1; i >= 0; --i)
+			for (std::size_t offset = m_spilledHead; offset != cNoBlock; offset = GetSpilledNext(offset))
 			{
-				if (m_freeMemBlocks[i].blockSize >= size && (static_cast<int>(m_freeMemBlocks[i].blockSize) - size <
-					smallestDiff))
+				const std::size_t blockSize = GetBlockSize(offset);
+				if (blockSize >= size && blockSize - size < smallestDiff)
 				{
-					smallestDiff = m_freeMemBlocks[i].blockSize - size;
-					bestIndex = i;
+					smallestDiff = blockSize - size;
+					bestOffset = offset;
 				}
 			}
 
-			return bestIndex;
+			return bestOffset;
 		}
 
 	private:
 		char* m_start_ptr = nullptr;
 		std::size_t m_currSize = 0;
-		Spinlock m_spinlock;
-		// We must fit to 32 KiB = L1 cache size
-		std::array<MemBlock, (cFreeMemBlocksSize - sizeof(AllocatorInterface) - sizeof(m_start_ptr) - sizeof(m_currSize) - sizeof(
-			           m_spinlock)) / sizeof(MemBlock)> m_freeMemBlocks;
+		std::size_t m_spilledHead = cNoBlock; // Offset of the first spilled free block
+		std::size_t m_spilledNum = 0;
+		TLock m_lock;
+		// We must fit to 32 KiB = L1 cache size. The table is kept as struct-of-arrays, so the best-fit search loads
+		// only the sizes, several per vector instruction (see BestFitSearch.h).
+		static constexpr std::size_t cFreeMemBlocksNum = (cFreeMemBlocksSize - sizeof(AllocatorInterface) - sizeof(m_start_ptr) -
+			sizeof(m_currSize) - sizeof(m_spilledHead) - sizeof(m_spilledNum) - sizeof(m_lock)) / (2 * sizeof(std::size_t));
+		std::array<std::size_t, cFreeMemBlocksNum> m_freeBlockSizes;
+		std::array<std::size_t, cFreeMemBlocksNum> m_freeBlockOffsets;
 	};
 }
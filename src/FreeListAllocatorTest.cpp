@@ -1,7 +1,12 @@
+#include "BuddyAllocator.h"
 #include "FreeListAllocator.h"
+#include "TLSFAllocator.h"
+#include "TreeFreeListAllocator.h"
 #include "Test.h"
 #include "benchmark/benchmark.h"
 
+#include <algorithm>
+#include <random>
 #include <vector>
 
 using namespace MemAlloc;
@@ -13,7 +18,7 @@ static void RunTest()
 	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
 	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
 
-	FreeListAllocator allocator(sMaxChunksNum * sMaxChunkSize);
+	FreeListAllocator<> allocator(sMaxChunksNum * sMaxChunkSize);
 	assert( sizeof(allocator) <= cFreeMemBlocksSize);
 	allocator.Init();
 
@@ -50,7 +55,6 @@ static void RunTest()
 		std::cout << green << "Test Passed!\n" << white;
 	}
 
-	allocator.FullMergeMemBlocks();
 	if (allocator.IsFullyMerged())
 	{
 		std::cout << green << "FullMerge Test Passed!\n" << white;
@@ -65,9 +69,81 @@ static void RunTest()
 
 TEST_REGISTER(FreeListAllocatorTest, RunTest);
 
+static void RunSpillTest()
+{
+	std::cout << "StartTest: FreeListAllocator spill\n";
+	std::cout << "Desc: Fills the allocator with small chunks, frees every other one so the free blocks overflow the table, refills the holes and deallocates in random order.\n";
+
+	FreeListAllocator<> allocator(sMaxChunksNum * 512); // About twice as many free blocks as the table holds
+	allocator.Init();
+
+	std::vector<void*> memPointers;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	while (void* p = allocator.TryAllocate(rand() % 64 + 1))
+	{
+		memPointers.emplace_back(p);
+	}
+
+	bool isFreed = true;
+	std::vector<void*> keptPointers;
+	for (std::size_t i = 0; i < memPointers.size(); ++i)
+	{
+		if (i % 2 == 0)
+		{
+			isFreed &= allocator.Free(memPointers[i]);
+		}
+		else
+		{
+			keptPointers.emplace_back(memPointers[i]);
+		}
+	}
+
+	const bool hasSpilled = allocator.GetSpilledMemBlocksNum() > 0;
+
+	while (void* p = allocator.TryAllocate(rand() % 64 + 1))
+	{
+		keptPointers.emplace_back(p);
+	}
+
+	std::shuffle(keptPointers.begin(), keptPointers.end(), std::mt19937(rand()));
+	for (void* p : keptPointers)
+	{
+		isFreed &= allocator.Free(p);
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (!isFreed || !hasSpilled || allocator.GetUsedSize() > 0)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	if (allocator.IsFullyMerged())
+	{
+		std::cout << green << "FullMerge Test Passed!\n" << white;
+	}
+	else
+	{
+		std::cout << red << "FullMerge Test Failed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("FreeListSpill     ", duration);
+}
+
+TEST_REGISTER(FreeListAllocatorSpillTest, RunSpillTest);
+
 static void BM_FreeListAlloc(benchmark::State& state)
 {
-	FreeListAllocator allocator(sMaxChunksNum * sMaxChunkSize);
+	FreeListAllocator<> allocator(sMaxChunksNum * sMaxChunkSize);
 
 	allocator.Init();
 
@@ -81,4 +157,122 @@ static void BM_FreeListAlloc(benchmark::State& state)
 	state.SetBytesProcessed(state.iterations());
 }
 
-BENCHMARK(BM_FreeListAlloc);
\ No newline at end of file
+BENCHMARK(BM_FreeListAlloc);
+
+static void BM_FreeListAllocThreads(benchmark::State& state)
+{
+	static FreeListAllocator<Spinlock>* sSharedFreeList = nullptr;
+
+	if (state.thread_index() == 0)
+	{
+		sSharedFreeList = new FreeListAllocator<Spinlock>(sMaxChunksNum * sMaxChunkSize);
+		sSharedFreeList->Init();
+	}
+
+	for (auto _ : state)
+	{
+		auto* p = sSharedFreeList->Allocate(1);
+		benchmark::DoNotOptimize(p);
+		sSharedFreeList->Free(p);
+	}
+
+	state.SetBytesProcessed(state.iterations());
+
+	if (state.thread_index() == 0)
+	{
+		delete sSharedFreeList;
+		sSharedFreeList = nullptr;
+	}
+}
+
+BENCHMARK(BM_FreeListAllocThreads)->ThreadRange(1, 16)->UseRealTime();
+
+// Allocates and frees a random size while state.range(0) free fragments are left between live blocks.
+// The linear scans of FreeListAllocator grow with the fragments, the TLSF and buddy lists and the trees don't.
+template <class TAllocator>
+static void BM_AllocFragmented(benchmark::State& state)
+{
+	const std::size_t fragmentsNum = static_cast<std::size_t>(state.range(0));
+
+	TAllocator allocator(4 * fragmentsNum * sMaxChunkSize);
+	allocator.Init();
+
+	std::vector<void*> memPointers;
+	memPointers.reserve(2 * fragmentsNum);
+	for (std::size_t i = 0; i < 2 * fragmentsNum; ++i)
+	{
+		memPointers.emplace_back(allocator.Allocate(rand() % sMaxChunkSize + 1));
+	}
+
+	for (std::size_t i = 0; i < memPointers.size(); i += 2)
+	{
+		allocator.Free(memPointers[i]);
+	}
+
+	std::vector<std::size_t> sizes(1024);
+	for (auto& size : sizes)
+	{
+		size = rand() % sMaxChunkSize + 1;
+	}
+
+	std::size_t sizeIdx = 0;
+	for (auto _ : state)
+	{
+		auto* p = allocator.Allocate(sizes[sizeIdx]);
+		benchmark::DoNotOptimize(p);
+		allocator.Free(p);
+
+		sizeIdx = (sizeIdx + 1) % sizes.size();
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_AllocFragmented<FreeListAllocator<>>)->Arg(100)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_AllocFragmented<TLSFAllocator<>>)->Arg(100)->Arg(1000)->Arg(10000)->Arg(50000);
+BENCHMARK(BM_AllocFragmented<TreeFreeListAllocator<>>)->Arg(100)->Arg(1000)->Arg(10000)->Arg(50000);
+BENCHMARK(BM_AllocFragmented<BuddyAllocator<>>)->Arg(100)->Arg(1000)->Arg(10000)->Arg(50000);
+
+// Only the frees of the random-order test are timed, each one merges with whatever neighbours or buddies are free
+template <class TAllocator>
+static void BM_RandomOrderFree(benchmark::State& state)
+{
+	TAllocator allocator(sMaxChunksNum * sMaxChunkSize);
+	allocator.Init();
+
+	std::vector<std::size_t> sizes(sMaxChunksNum);
+	std::vector<std::size_t> freeOrder(sMaxChunksNum);
+	for (std::size_t i = 0; i < sMaxChunksNum; ++i)
+	{
+		sizes[i] = rand() % sMaxChunkSize + 1;
+		freeOrder[i] = i;
+	}
+	std::shuffle(freeOrder.begin(), freeOrder.end(), std::mt19937(rand()));
+
+	std::vector<void*> memPointers(sMaxChunksNum);
+
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < sMaxChunksNum; ++i)
+		{
+			memPointers[i] = allocator.Allocate(sizes[i]);
+		}
+
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		for (const std::size_t idx : freeOrder)
+		{
+			allocator.Free(memPointers[idx]);
+		}
+
+		const auto finish = std::chrono::high_resolution_clock::now();
+		state.SetIterationTime(std::chrono::duration<double>(finish - start).count());
+
+		allocator.Reset();
+	}
+
+	state.SetItemsProcessed(state.iterations() * sMaxChunksNum);
+}
+
+BENCHMARK(BM_RandomOrderFree<FreeListAllocator<>>)->UseManualTime();
+BENCHMARK(BM_RandomOrderFree<BuddyAllocator<>>)->UseManualTime();
\ No newline at end of file
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "AllocatorInterface.h"
+#include <cassert>
+#include <cstdint>
+#include <new>
+
+namespace MemAlloc
+{
+	// Pool allocator whose free chunks form an intrusive Treiber stack (see StackLinkedList) linked through the chunks.
+	// The head packs the index of the top chunk with a version tag that changes on every push and pop,
+	// so a CAS against a stale head fails even if the same chunk is on top again (ABA).
+	class LockFreePoolAllocator final : public AllocatorInterface
+	{
+		struct FreeChunk
+		{
+			std::atomic<std::uint32_t> next; // Index + 1 of the next free chunk, 0 for the last one
+		};
+
+		static constexpr std::uint64_t cIndexMask = 0xFFFFFFFF;
+		static constexpr std::uint32_t cTagShift = 32;
+
+	public:
+		LockFreePoolAllocator() = delete;
+		LockFreePoolAllocator(const LockFreePoolAllocator&) = delete;
+
+		LockFreePoolAllocator(const std::size_t chunksNum, const std::size_t chunkSize)
+			: AllocatorInterface(chunksNum * chunkSize), m_chunksNum(chunksNum), m_chunkSize(chunkSize)
+		{
+			assert(((chunkSize % sizeof(std::size_t)) == 0) && "Chunk size must be aligned to std::size_t");
+			assert(chunksNum < cIndexMask && "Chunk index must fit to 32 bits");
+		}
+
+		~LockFreePoolAllocator() override
+		{
+			free(m_start_ptr);
+		}
+
+		void Init() override
+		{
+			free(m_start_ptr);
+			m_start_ptr = static_cast<char*>(malloc(m_totalSize));
+
+			Reset();
+		}
+
+		void* Allocate(const std::size_t allocationSize, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			assert(allocationSize <= m_chunkSize && "Allocation size must be <= to chunk size");
+
+			std::uint64_t head = m_head.load(std::memory_order_acquire);
+			std::uint64_t newHead = 0;
+			FreeChunk* chunk = nullptr;
+
+			do
+			{
+				const std::uint32_t index = static_cast<std::uint32_t>(head & cIndexMask);
+
+				assert(index != 0 && "The pool allocator is full");
+				if (index == 0)
+				{
+					return nullptr;
+				}
+
+				chunk = GetChunk(index);
+				// The chunk may already be popped and reused by another thread, then the tag makes the CAS fail
+				newHead = MakeHead(chunk->next.load(std::memory_order_relaxed), head);
+			}
+			while (!m_head.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire));
+
+			assert(PTR_TO_INT(chunk) % alignment == 0 && "Data address must be aligment");
+
+			return chunk;
+		}
+
+		bool Free(void* ptr) override
+		{
+			if (ptr < m_start_ptr || ptr >= m_start_ptr + m_totalSize)
+			{
+				return false;
+			}
+
+			auto* chunk = static_cast<FreeChunk*>(ptr);
+			const std::uint32_t index = static_cast<std::uint32_t>((PTR_TO_CHAR(ptr) - m_start_ptr) / m_chunkSize) + 1;
+
+			std::uint64_t head = m_head.load(std::memory_order_relaxed);
+			do
+			{
+				chunk->next.store(static_cast<std::uint32_t>(head & cIndexMask), std::memory_order_relaxed);
+			}
+			while (!m_head.compare_exchange_weak(head, MakeHead(index, head), std::memory_order_release, std::memory_order_relaxed));
+
+			return true;
+		}
+
+		// Not thread safe
+		void Reset()
+		{
+			for (std::size_t i = 0; i < m_chunksNum; ++i)
+			{
+				const std::uint32_t next = (i + 1 < m_chunksNum) ? static_cast<std::uint32_t>(i + 2) : 0;
+				new (m_start_ptr + i * m_chunkSize) FreeChunk{{next}};
+			}
+
+			m_head.store(m_chunksNum > 0 ? 1 : 0, std::memory_order_release);
+		}
+
+		// Walks the free list, so it is exact only while no other thread allocates or frees
+		std::size_t GetUsedSize() const override
+		{
+			std::size_t freeChunksNum = 0;
+
+			for (std::uint32_t index = static_cast<std::uint32_t>(m_head.load(std::memory_order_acquire) & cIndexMask);
+			     index != 0; index = GetChunk(index)->next.load(std::memory_order_relaxed))
+			{
+				++freeChunksNum;
+			}
+
+			return (m_chunksNum - freeChunksNum) * m_chunkSize;
+		}
+
+		std::size_t GetChunkSize() const
+		{
+			return m_chunkSize;
+		}
+
+	private:
+		FreeChunk* GetChunk(const std::uint32_t index) const
+		{
+			return reinterpret_cast<FreeChunk*>(m_start_ptr + (index - 1) * m_chunkSize);
+		}
+
+		// Bumps the tag of the previous head
+		static std::uint64_t MakeHead(const std::uint32_t index, const std::uint64_t prevHead)
+		{
+			return (((prevHead >> cTagShift) + 1) << cTagShift) | index;
+		}
+
+	private:
+		char* m_start_ptr = nullptr;
+		std::size_t m_chunksNum = 0;
+		std::size_t m_chunkSize = 0;
+		alignas(64) std::atomic<std::uint64_t> m_head{0};
+	};
+} // namespace MemAlloc
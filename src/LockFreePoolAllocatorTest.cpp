@@ -0,0 +1,105 @@
+#include "LockFreePoolAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+using namespace MemAlloc;
+
+static void RunTest()
+{
+	constexpr std::size_t threadsNum = 4;
+
+	std::cout << "StartMultiThreadTest: LockFreePoolAllocator\n";
+	std::cout << "Desc: Creates a lock-free pool allocator. Create " << threadsNum << " threads. Each thread allocates chunks(MaxChunksNum / " << threadsNum << ") of 64 bytes, marks them and deallocates in random order.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+
+	LockFreePoolAllocator allocator(sMaxChunksNum, 64);
+	allocator.Init();
+
+	std::atomic<bool> corrupted{false};
+
+	auto threadFunc = [&allocator, &corrupted](const std::size_t threadIdx){
+		std::vector<void*> memPointers;
+		memPointers.reserve(sMaxChunksNum / threadsNum);
+
+		for (std::size_t i = 0; i < sMaxChunksNum / threadsNum; ++i)
+		{
+			auto* p = static_cast<std::size_t*>(allocator.Allocate(sizeof(std::size_t)));
+			*p = threadIdx;
+			memPointers.emplace_back(p);
+		}
+
+		const std::size_t memPointersNum = memPointers.size();
+		for (int i = static_cast<int>(memPointersNum) - 1; i >= 0; --i)
+		{
+			const auto idx = (i != 0 ? rand() % i : 0);
+			if (*static_cast<std::size_t*>(memPointers[idx]) != threadIdx)
+			{
+				corrupted = true;
+			}
+			allocator.Free(memPointers[idx]);
+			memPointers.erase(memPointers.begin() + idx);
+		}
+	};
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < threadsNum; ++i)
+	{
+		threads.emplace_back(threadFunc, i);
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (allocator.GetUsedSize() > 0 || corrupted)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("LockFreePool4T    ", duration);
+}
+
+TEST_REGISTER(LockFreePoolAllocatorTest, RunTest);
+
+// Compare with BM_PoolAllocThreads<Spinlock>, the same loop over a spinlocked pool
+static LockFreePoolAllocator* sLockFreePool = nullptr;
+
+static void BM_LockFreePoolAlloc(benchmark::State& state)
+{
+	if (state.thread_index() == 0)
+	{
+		sLockFreePool = new LockFreePoolAllocator(sMaxChunksNum, 64);
+		sLockFreePool->Init();
+	}
+
+	for (auto _ : state)
+	{
+		auto* p = sLockFreePool->Allocate(1);
+		benchmark::DoNotOptimize(p);
+		sLockFreePool->Free(p);
+	}
+
+	state.SetBytesProcessed(state.iterations());
+
+	if (state.thread_index() == 0)
+	{
+		delete sLockFreePool;
+		sLockFreePool = nullptr;
+	}
+}
+
+BENCHMARK(BM_LockFreePoolAlloc)->ThreadRange(2, 16)->UseRealTime();
\ No newline at end of file
@@ -0,0 +1,281 @@
+#pragma once
+
+#include "AllocatorInterface.h"
+#include <cassert>
+#include <cstdint>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Locks with the same lock()/unlock()/try_lock() shape as Spinlock, usable as an allocator lock policy
+namespace MemAlloc
+{
+	constexpr std::size_t cSpinsBeforeYield = 64;
+
+	inline void CpuRelax()
+	{
+#if defined(_MSC_VER)
+		_mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__)
+		asm volatile("yield");
+#endif
+	}
+
+	// Spins for a while and then yields, so that waiters don't starve a preempted lock holder
+	struct SpinWait
+	{
+		void Wait()
+		{
+			if (++m_spins == cSpinsBeforeYield)
+			{
+				m_spins = 0;
+				std::this_thread::yield();
+			}
+			else
+			{
+				CpuRelax();
+			}
+		}
+
+		std::size_t m_spins = 0;
+	};
+
+	// FIFO spinlock: threads take a ticket and wait until it is served
+	class TicketLock
+	{
+	public:
+		TicketLock() = default;
+		TicketLock(const TicketLock&) = delete;
+		TicketLock& operator=(const TicketLock&) = delete;
+
+		void lock()
+		{
+			const std::uint32_t ticket = m_next.fetch_add(1, std::memory_order_relaxed);
+
+			SpinWait spinWait;
+			while (m_serving.load(std::memory_order_acquire) != ticket)
+			{
+				spinWait.Wait();
+			}
+		}
+
+		bool try_lock()
+		{
+			std::uint32_t serving = m_serving.load(std::memory_order_relaxed);
+			return m_next.compare_exchange_strong(serving, serving + 1, std::memory_order_acquire, std::memory_order_relaxed);
+		}
+
+		void unlock()
+		{
+			m_serving.store(m_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+	private:
+		std::atomic<std::uint32_t> m_next{0};
+		std::atomic<std::uint32_t> m_serving{0};
+	};
+
+	// Queue lock: every waiter spins on a flag in its own node, so a release touches only the next waiter's cache line.
+	// Nodes come from a small per-thread set, which bounds how many McsLocks one thread may hold at once.
+	class McsLock
+	{
+		struct alignas(64) Node
+		{
+			std::atomic<Node*> next{nullptr};
+			std::atomic<bool> locked{false};
+		};
+
+		static constexpr std::uint32_t cMaxHeldLocks = 8;
+
+		struct ThreadNodes
+		{
+			Node nodes[cMaxHeldLocks];
+			std::uint32_t usedMask = 0;
+		};
+
+	public:
+		McsLock() = default;
+		McsLock(const McsLock&) = delete;
+		McsLock& operator=(const McsLock&) = delete;
+
+		void lock()
+		{
+			Node* node = AcquireNode();
+			Node* prev = m_tail.exchange(node, std::memory_order_acq_rel);
+
+			if (prev != nullptr)
+			{
+				node->locked.store(true, std::memory_order_relaxed);
+				prev->next.store(node, std::memory_order_release);
+
+				SpinWait spinWait;
+				while (node->locked.load(std::memory_order_acquire))
+				{
+					spinWait.Wait();
+				}
+			}
+
+			m_holder = node;
+		}
+
+		bool try_lock()
+		{
+			Node* node = AcquireNode();
+			Node* expected = nullptr;
+
+			if (m_tail.compare_exchange_strong(expected, node, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				m_holder = node;
+				return true;
+			}
+
+			ReleaseNode(node);
+			return false;
+		}
+
+		void unlock()
+		{
+			Node* node = m_holder;
+			Node* next = node->next.load(std::memory_order_acquire);
+
+			if (next == nullptr)
+			{
+				Node* expected = node;
+				if (m_tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed))
+				{
+					ReleaseNode(node);
+					return;
+				}
+
+				// A waiter has swapped the tail but not linked itself yet
+				while ((next = node->next.load(std::memory_order_acquire)) == nullptr)
+				{
+					CpuRelax();
+				}
+			}
+
+			next->locked.store(false, std::memory_order_release);
+			ReleaseNode(node);
+		}
+
+	private:
+		static Node* AcquireNode()
+		{
+			ThreadNodes& threadNodes = GetThreadNodes();
+
+			std::uint32_t index = 0;
+			while (index < cMaxHeldLocks && (threadNodes.usedMask & (1u << index)) != 0)
+			{
+				++index;
+			}
+
+			assert(index < cMaxHeldLocks && "Too many McsLocks held by one thread");
+
+			threadNodes.usedMask |= 1u << index;
+
+			Node* node = &threadNodes.nodes[index];
+			node->next.store(nullptr, std::memory_order_relaxed);
+			return node;
+		}
+
+		static void ReleaseNode(Node* node)
+		{
+			ThreadNodes& threadNodes = GetThreadNodes();
+			threadNodes.usedMask &= ~(1u << static_cast<std::uint32_t>(node - threadNodes.nodes));
+		}
+
+		static ThreadNodes& GetThreadNodes()
+		{
+			static thread_local ThreadNodes sThreadNodes;
+			return sThreadNodes;
+		}
+
+	private:
+		std::atomic<Node*> m_tail{nullptr};
+		Node* m_holder = nullptr; // Written and read only by the thread holding the lock
+	};
+
+	// Spins briefly and then parks the thread on a futex (on Linux; elsewhere it keeps yielding).
+	// States: 0 - unlocked, 1 - locked, 2 - locked and there may be parked waiters.
+	class AdaptiveLock
+	{
+		static constexpr std::size_t cSpinsBeforePark = 100;
+
+	public:
+		AdaptiveLock() = default;
+		AdaptiveLock(const AdaptiveLock&) = delete;
+		AdaptiveLock& operator=(const AdaptiveLock&) = delete;
+
+		void lock()
+		{
+			int state = 0;
+			for (std::size_t i = 0; i < cSpinsBeforePark; ++i)
+			{
+				state = 0;
+				if (m_state.compare_exchange_weak(state, 1, std::memory_order_acquire, std::memory_order_relaxed))
+				{
+					return;
+				}
+
+				if (state == 2)
+				{
+					break;
+				}
+
+				CpuRelax();
+			}
+
+			if (state != 2)
+			{
+				state = m_state.exchange(2, std::memory_order_acquire);
+			}
+
+			while (state != 0)
+			{
+				Park();
+				state = m_state.exchange(2, std::memory_order_acquire);
+			}
+		}
+
+		bool try_lock()
+		{
+			int state = 0;
+			return m_state.compare_exchange_strong(state, 1, std::memory_order_acquire, std::memory_order_relaxed);
+		}
+
+		void unlock()
+		{
+			if (m_state.exchange(0, std::memory_order_release) == 2)
+			{
+				Unpark();
+			}
+		}
+
+	private:
+		void Park()
+		{
+#ifdef __linux__
+			syscall(SYS_futex, reinterpret_cast<int*>(&m_state), FUTEX_WAIT_PRIVATE, 2, nullptr, nullptr, 0);
+#else
+			std::this_thread::yield();
+#endif
+		}
+
+		void Unpark()
+		{
+#ifdef __linux__
+			syscall(SYS_futex, reinterpret_cast<int*>(&m_state), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+		}
+
+	private:
+		std::atomic<int> m_state{0};
+	};
+} // namespace MemAlloc
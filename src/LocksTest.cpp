@@ -0,0 +1,123 @@
+#include "Locks.h"
+#include "PoolAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <mutex>
+#include <vector>
+
+using namespace MemAlloc;
+
+// Every thread increments a shared counter under the lock, and allocates and frees chunks of a pool locked with it
+template <class TLock>
+static bool RunLockTest(const char* lockName)
+{
+	constexpr std::size_t threadsNum = 4;
+	constexpr std::size_t incrementsNum = 20000;
+
+	TLock lock;
+	std::size_t counter = 0;
+
+	PoolAllocator<TLock> allocator(sMaxChunksNum, 64);
+	allocator.Init();
+
+	auto threadFunc = [&lock, &counter, &allocator](){
+		for (std::size_t i = 0; i < incrementsNum; ++i)
+		{
+			if (i % 2 == 0 || !lock.try_lock())
+			{
+				lock.lock();
+			}
+			++counter;
+			lock.unlock();
+		}
+
+		std::vector<void*> memPointers;
+		for (std::size_t i = 0; i < sMaxChunksNum / threadsNum; ++i)
+		{
+			memPointers.emplace_back(allocator.Allocate(64));
+		}
+
+		for (auto* p : memPointers)
+		{
+			allocator.Free(p);
+		}
+	};
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < threadsNum; ++i)
+	{
+		threads.emplace_back(threadFunc);
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << lockName << ": Time = " << duration << "ns\n";
+
+	return counter == threadsNum * incrementsNum && allocator.GetUsedSize() == 0;
+}
+
+static void RunTest()
+{
+	std::cout << "StartMultiThreadTest: Locks\n";
+	std::cout << "Desc: Create 4 threads. Each thread increments a shared counter under the lock, then allocates and deallocates chunks of a pool allocator that uses the lock.\n";
+
+	bool passed = RunLockTest<Spinlock>("Spinlock");
+	passed &= RunLockTest<TicketLock>("TicketLock");
+	passed &= RunLockTest<McsLock>("McsLock");
+	passed &= RunLockTest<AdaptiveLock>("AdaptiveLock");
+	passed &= RunLockTest<std::mutex>("std::mutex");
+
+	if (passed)
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+	else
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+}
+
+TEST_REGISTER(LocksTest, RunTest);
+
+// handoff_ratio is the share of acquisitions that went to a different thread than the previous one.
+// Under contention a fair lock keeps it near 1, while an unfair one lets the releasing thread barge back in.
+template <class TLock>
+static void BM_LockContention(benchmark::State& state)
+{
+	static TLock sLock;
+	static std::size_t sCounter = 0;
+	static int sLastOwner = -1;
+
+	const int threadIdx = state.thread_index();
+	std::size_t handoffs = 0;
+
+	for (auto _ : state)
+	{
+		sLock.lock();
+		if (sLastOwner != threadIdx)
+		{
+			sLastOwner = threadIdx;
+			++handoffs;
+		}
+		benchmark::DoNotOptimize(++sCounter);
+		sLock.unlock();
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	state.counters["handoff_ratio"] = benchmark::Counter(static_cast<double>(handoffs), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_TEMPLATE(BM_LockContention, Spinlock)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LockContention, TicketLock)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LockContention, McsLock)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LockContention, AdaptiveLock)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LockContention, std::mutex)->ThreadRange(1, 16)->UseRealTime();
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "FreeListAllocator.h"
+#include "NumaTopology.h"
+#include "PoolAllocator.h"
+#include <memory>
+#include <vector>
+
+namespace MemAlloc
+{
+	// Keeps one arena per NUMA node. Init() sets every arena up from a thread pinned to the node's CPUs and touches
+	// all of its pages there, so that first-touch placement backs the arena with node-local memory.
+	// A thread allocates from the arena of the node it runs on and moves on to the other nodes when that one is full.
+	// A pointer is freed to the arena whose range contains it.
+	template <class TArena, class TLock = Spinlock>
+	class NumaArenaAllocator final : public AllocatorInterface
+	{
+		struct NodeArena
+		{
+			template <class... TArgs>
+			NodeArena(const TArgs&... arenaArgs) : m_arena(arenaArgs...)
+			{
+			}
+
+			TLock m_lock;
+			TArena m_arena;
+		};
+
+	public:
+		NumaArenaAllocator(const NumaArenaAllocator&) = delete;
+
+		// Every node gets an arena constructed from 'arenaArgs'
+		template <class... TArgs>
+		NumaArenaAllocator(const NumaTopology& topology, const TArgs&... arenaArgs)
+			: AllocatorInterface(0), m_topology(topology)
+		{
+			m_nodeArenas.reserve(m_topology.GetNodesNum());
+			for (std::size_t i = 0; i < m_topology.GetNodesNum(); ++i)
+			{
+				m_nodeArenas.emplace_back(new NodeArena(arenaArgs...));
+				m_totalSize += m_nodeArenas.back()->m_arena.GetTotalSize();
+			}
+		}
+
+		void Init() override
+		{
+			std::vector<std::thread> threads;
+
+			for (std::size_t i = 0; i < m_nodeArenas.size(); ++i)
+			{
+				threads.emplace_back([this, i](){
+					// Simulated nodes may have no CPUs to pin to, their arenas stay wherever the OS puts them
+					PinThreadToCpus(m_topology.GetNodeCpus(i));
+
+					TArena& arena = m_nodeArenas[i]->m_arena;
+					arena.Init();
+					arena.FirstTouch();
+				});
+			}
+
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+		}
+
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			const std::size_t homeNode = GetThreadNode();
+
+			for (std::size_t i = 0; i < m_nodeArenas.size(); ++i)
+			{
+				NodeArena& nodeArena = *m_nodeArenas[(homeNode + i) % m_nodeArenas.size()];
+				LockGuard<TLock> guard(nodeArena.m_lock);
+
+				void* resultPtr = nodeArena.m_arena.TryAllocate(size, alignment);
+				if (resultPtr != nullptr)
+				{
+					return resultPtr;
+				}
+			}
+
+			assert(false && "Not enough memory");
+			return nullptr;
+		}
+
+		bool Free(void* ptr) override
+		{
+			for (auto& nodeArena : m_nodeArenas)
+			{
+				if (nodeArena->m_arena.Contains(ptr))
+				{
+					LockGuard<TLock> guard(nodeArena->m_lock);
+					return nodeArena->m_arena.Free(ptr);
+				}
+			}
+
+			return false;
+		}
+
+		std::size_t GetUsedSize() const override
+		{
+			std::size_t usedSize = 0;
+			for (const auto& nodeArena : m_nodeArenas)
+			{
+				usedSize += nodeArena->m_arena.GetUsedSize();
+			}
+
+			return usedSize;
+		}
+
+		std::size_t GetNodesNum() const
+		{
+			return m_nodeArenas.size();
+		}
+
+		// Node whose arena contains the pointer, or GetNodesNum() for foreign pointers
+		std::size_t GetPtrNode(const void* ptr) const
+		{
+			for (std::size_t i = 0; i < m_nodeArenas.size(); ++i)
+			{
+				if (m_nodeArenas[i]->m_arena.Contains(ptr))
+				{
+					return i;
+				}
+			}
+
+			return m_nodeArenas.size();
+		}
+
+		// Node the calling thread allocates from
+		std::size_t GetThreadNode() const
+		{
+			const int nodeOverride = GetThreadNumaNode();
+			if (nodeOverride >= 0)
+			{
+				return static_cast<std::size_t>(nodeOverride) % m_nodeArenas.size();
+			}
+
+			const int cpu = GetCurrentCpu();
+			return cpu >= 0 ? m_topology.GetCpuNode(static_cast<std::size_t>(cpu)) : 0;
+		}
+
+	private:
+		const NumaTopology m_topology;
+		std::vector<std::unique_ptr<NodeArena>> m_nodeArenas;
+	};
+
+	template <class TLock = Spinlock>
+	using NumaPoolAllocator = NumaArenaAllocator<PoolAllocator<>, TLock>;
+
+	template <class TLock = Spinlock>
+	using NumaFreeListAllocator = NumaArenaAllocator<FreeListAllocator<>, TLock>;
+} // namespace MemAlloc
@@ -0,0 +1,176 @@
+#include "NumaArenaAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+using namespace MemAlloc;
+
+namespace
+{
+	constexpr std::size_t cSimulatedNodesNum = 2;
+
+	// Each thread serves itself from node 'threadIdx % cSimulatedNodesNum'. Returns false if a chunk comes from another node.
+	template <class TAllocator>
+	bool RunNumaThreads(TAllocator& allocator, const std::size_t threadsNum, const std::size_t maxSize)
+	{
+		std::atomic<bool> failed{false};
+
+		auto threadFunc = [&allocator, &failed, maxSize](const std::size_t threadIdx, const std::size_t chunksNum){
+			const std::size_t node = threadIdx % cSimulatedNodesNum;
+			SetThreadNumaNode(static_cast<int>(node));
+
+			std::vector<void*> memPointers;
+			memPointers.reserve(chunksNum);
+
+			for (std::size_t i = 0; i < chunksNum; ++i)
+			{
+				void* p = allocator.Allocate(rand() % maxSize + 1);
+				if (allocator.GetPtrNode(p) != node)
+				{
+					failed = true;
+				}
+				memPointers.emplace_back(p);
+			}
+
+			const std::size_t memPointersNum = memPointers.size();
+			for (int i = static_cast<int>(memPointersNum) - 1; i >= 0; --i)
+			{
+				const auto idx = (i != 0 ? rand() % i : 0);
+				if (!allocator.Free(memPointers[idx]))
+				{
+					failed = true;
+				}
+				memPointers.erase(memPointers.begin() + idx);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (std::size_t i = 0; i < threadsNum; ++i)
+		{
+			threads.emplace_back(threadFunc, i, sMaxChunksNum / threadsNum);
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		return !failed;
+	}
+}
+
+static void RunTopologyTest()
+{
+	std::cout << "StartTest: NumaTopology\n";
+	std::cout << "Desc: Reads the NUMA topology from /sys and checks that every CPU belongs to exactly one node. Checks a simulated topology of " << cSimulatedNodesNum << " nodes.\n";
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	const NumaTopology systemTopology = NumaTopology::FromSystem();
+	const NumaTopology simulatedTopology = NumaTopology::Simulated(cSimulatedNodesNum, 8);
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+	std::cout << "NodesNum " << systemTopology.GetNodesNum() << "\n";
+
+	bool isValid = systemTopology.GetNodesNum() > 0 && simulatedTopology.GetNodesNum() == cSimulatedNodesNum;
+
+	std::size_t cpusNum = 0;
+	for (std::size_t node = 0; node < systemTopology.GetNodesNum(); ++node)
+	{
+		for (const std::size_t cpu : systemTopology.GetNodeCpus(node))
+		{
+			isValid = isValid && systemTopology.GetCpuNode(cpu) == node;
+			++cpusNum;
+		}
+	}
+	isValid = isValid && cpusNum >= std::thread::hardware_concurrency();
+
+	isValid = isValid && simulatedTopology.GetNodeCpus(0).size() == 4 && simulatedTopology.GetCpuNode(3) == 0 && simulatedTopology.GetCpuNode(4) == 1;
+
+	if (!isValid)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("NumaTopology      ", duration);
+}
+
+TEST_REGISTER(NumaTopologyTest, RunTopologyTest);
+
+static void RunTest()
+{
+	constexpr std::size_t threadsNum = 4;
+
+	std::cout << "StartMultiThreadTest: NumaPoolAllocator, NumaFreeListAllocator\n";
+	std::cout << "Desc: Creates NUMA allocators over a simulated topology of " << cSimulatedNodesNum << " nodes. Create " << threadsNum << " threads, each bound to a node. Each thread allocates chunks(MaxChunksNum / " << threadsNum << "), checks that they come from its node and deallocates in random order.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
+
+	const NumaTopology topology = NumaTopology::Simulated(cSimulatedNodesNum);
+
+	NumaPoolAllocator<> poolAllocator(topology, sMaxChunksNum, 64);
+	NumaFreeListAllocator<> freeListAllocator(topology, 2 * sMaxChunksNum * sMaxChunkSize);
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	poolAllocator.Init();
+	freeListAllocator.Init();
+
+	const bool isPoolValid = RunNumaThreads(poolAllocator, threadsNum, 64);
+	const bool isFreeListValid = RunNumaThreads(freeListAllocator, threadsNum, sMaxChunkSize);
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (!isPoolValid || !isFreeListValid || poolAllocator.GetUsedSize() > 0 || freeListAllocator.GetUsedSize() > 0)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("NumaAllocators4T  ", duration);
+}
+
+TEST_REGISTER(NumaArenaAllocatorTest, RunTest);
+
+// Compare with BM_PoolAllocThreads<Spinlock>: on a multi-node machine threads only share the lock of their node
+static NumaPoolAllocator<>* sNumaPool = nullptr;
+
+static void BM_NumaPoolAlloc(benchmark::State& state)
+{
+	if (state.thread_index() == 0)
+	{
+		sNumaPool = new NumaPoolAllocator<>(NumaTopology::FromSystem(), sMaxChunksNum, 64);
+		sNumaPool->Init();
+	}
+
+	for (auto _ : state)
+	{
+		auto* p = sNumaPool->Allocate(1);
+		benchmark::DoNotOptimize(p);
+		sNumaPool->Free(p);
+	}
+
+	state.SetBytesProcessed(state.iterations());
+
+	if (state.thread_index() == 0)
+	{
+		delete sNumaPool;
+		sNumaPool = nullptr;
+	}
+}
+
+BENCHMARK(BM_NumaPoolAlloc)->ThreadRange(1, 16)->UseRealTime();
\ No newline at end of file
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace MemAlloc
+{
+	// Current CPU of the calling thread, or -1 when the platform doesn't tell
+	inline int GetCurrentCpu()
+	{
+#ifdef __linux__
+		return sched_getcpu();
+#else
+		return -1;
+#endif
+	}
+
+	// NUMA node that the calling thread has chosen explicitly with SetThreadNumaNode, or -1
+	inline int& GetThreadNumaNode()
+	{
+		static thread_local int sThreadNumaNode = -1;
+		return sThreadNumaNode;
+	}
+
+	// Makes NUMA-aware allocators serve the calling thread from the given node instead of its CPU's node.
+	// -1 restores the default.
+	inline void SetThreadNumaNode(const int node)
+	{
+		GetThreadNumaNode() = node;
+	}
+
+	// Restricts the calling thread to the given CPUs. Returns false when none of them can be used.
+	inline bool PinThreadToCpus(const std::vector<std::size_t>& cpus)
+	{
+#ifdef __linux__
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+
+		for (const std::size_t cpu : cpus)
+		{
+			if (cpu < CPU_SETSIZE)
+			{
+				CPU_SET(cpu, &cpuSet);
+			}
+		}
+
+		return CPU_COUNT(&cpuSet) > 0 && sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0;
+#else
+		return false;
+#endif
+	}
+
+	// CPUs of every NUMA node. Nodes are numbered densely from 0, whatever their ids in the system are.
+	class NumaTopology
+	{
+	public:
+		// Reads /sys/devices/system/node. Falls back to a single node with every CPU when it isn't available.
+		static NumaTopology FromSystem()
+		{
+			NumaTopology topology;
+
+			for (const std::size_t node : ReadCpuList("/sys/devices/system/node/online"))
+			{
+				topology.AddNode(ReadCpuList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+			}
+
+			return topology.GetNodesNum() > 0 ? topology : Simulated(1);
+		}
+
+		// Splits 'cpusNum' CPUs into 'nodesNum' contiguous groups. With more nodes than CPUs some nodes have
+		// no CPUs and are reached only by threads that choose their node explicitly.
+		static NumaTopology Simulated(const std::size_t nodesNum, const std::size_t cpusNum = std::thread::hardware_concurrency())
+		{
+			NumaTopology topology;
+
+			for (std::size_t node = 0; node < nodesNum; ++node)
+			{
+				std::vector<std::size_t> cpus;
+				for (std::size_t cpu = node * cpusNum / nodesNum; cpu < (node + 1) * cpusNum / nodesNum; ++cpu)
+				{
+					cpus.push_back(cpu);
+				}
+
+				topology.AddNode(std::move(cpus));
+			}
+
+			return topology;
+		}
+
+		std::size_t GetNodesNum() const
+		{
+			return m_nodeCpus.size();
+		}
+
+		const std::vector<std::size_t>& GetNodeCpus(const std::size_t node) const
+		{
+			return m_nodeCpus[node];
+		}
+
+		// Unknown CPUs belong to node 0
+		std::size_t GetCpuNode(const std::size_t cpu) const
+		{
+			return cpu < m_cpuNodes.size() ? m_cpuNodes[cpu] : 0;
+		}
+
+	private:
+		void AddNode(std::vector<std::size_t> cpus)
+		{
+			const std::size_t node = m_nodeCpus.size();
+
+			for (const std::size_t cpu : cpus)
+			{
+				if (cpu >= m_cpuNodes.size())
+				{
+					m_cpuNodes.resize(cpu + 1, 0);
+				}
+				m_cpuNodes[cpu] = node;
+			}
+
+			m_nodeCpus.push_back(std::move(cpus));
+		}
+
+		// Parses lists like "0-3,8-11". A missing file is an empty list.
+		static std::vector<std::size_t> ReadCpuList(const std::string& path)
+		{
+			std::vector<std::size_t> values;
+
+			std::ifstream file(path);
+			std::string range;
+
+			while (std::getline(file, range, ','))
+			{
+				const char* text = range.c_str();
+				char* end = nullptr;
+
+				const std::size_t first = std::strtoul(text, &end, 10);
+				if (end == text)
+				{
+					continue;
+				}
+
+				const std::size_t last = *end == '-' ? std::strtoul(end + 1, nullptr, 10) : first;
+				for (std::size_t value = first; value <= last; ++value)
+				{
+					values.push_back(value);
+				}
+			}
+
+			return values;
+		}
+
+	private:
+		std::vector<std::vector<std::size_t>> m_nodeCpus;
+		std::vector<std::size_t> m_cpuNodes;
+	};
+} // namespace MemAlloc
@@ -0,0 +1,288 @@
+#pragma once
+
+#include "AllocatorInterface.h"
+#include "PoolAllocator.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace MemAlloc
+{
+	constexpr std::size_t cObjectCacheLineSize = 64;
+	constexpr std::size_t cDefaultSlabSize = 16 * 1024;
+
+	// Reset hook that leaves a reused object as its previous owner left it
+	struct NoObjectReset
+	{
+		template <class T>
+		void operator()(T&) const
+		{
+		}
+	};
+
+	// Slab cache of constructed objects in the style of Bonwick's slab allocator. Slabs are chunks of a PoolAllocator,
+	// each one holds a header, a stack of its free object indices and the objects. An object is constructed the first
+	// time it is handed out and stays constructed when it is freed, so reusing it only runs TReset, a cheap hook that
+	// puts it back in its initial state. The destructors run when Reap returns the empty slabs to the pool or when the
+	// cache is destroyed.
+	// Slabs are kept in partial, full and empty lists, Allocate takes from a partial slab first so that the empty ones
+	// can be reaped. The bytes left over at the end of a slab shift the objects of consecutive slabs by a cache line
+	// each (slab coloring), so that the same object of different slabs doesn't map to the same cache sets.
+	// TLock is the locking policy of the instance, NoLock by default (see AllocatorInterface.h)
+	template <class T, class TReset = NoObjectReset, class TLock = NoLock>
+	class ObjectCache final
+	{
+		static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported");
+
+		struct Slab
+		{
+			Slab* m_next;
+			Slab* m_prev;
+			T* m_objects;
+			std::uint32_t m_freeNum; // Size of the stack of free indices after the header
+			std::uint32_t m_constructedNum; // The objects below are constructed
+			std::uint32_t m_usedNum;
+		};
+
+		struct SlabList
+		{
+			Slab* m_head = nullptr;
+			std::size_t m_slabsNum = 0;
+		};
+
+	public:
+		ObjectCache(const ObjectCache&) = delete;
+
+		// The slab size must fit the header, the free indices and at least one object
+		ObjectCache(const std::size_t slabsNum, const std::size_t slabSize = cDefaultSlabSize)
+			: m_slabPool(slabsNum, slabSize)
+		{
+			assert(slabSize % cObjectCacheLineSize == 0 && "Slab size must be a multiple of the cache line size");
+
+			m_objectsPerSlab = (slabSize - sizeof(Slab)) / (sizeof(T) + sizeof(std::uint32_t));
+			while (m_objectsPerSlab > 0 && GetObjectsOffset(m_objectsPerSlab) + m_objectsPerSlab * sizeof(T) > slabSize)
+			{
+				--m_objectsPerSlab;
+			}
+			assert(m_objectsPerSlab > 0 && "Slab size is too small for the object");
+
+			const std::size_t leftoverSize = slabSize - GetObjectsOffset(m_objectsPerSlab) - m_objectsPerSlab * sizeof(T);
+			m_colorsNum = leftoverSize / cObjectCacheLineSize + 1;
+		}
+
+		~ObjectCache()
+		{
+			DestroySlabs(m_partial);
+			DestroySlabs(m_full);
+			DestroySlabs(m_empty);
+		}
+
+		void Init()
+		{
+			m_slabPool.Init();
+		}
+
+		T* Allocate()
+		{
+			T* object = TryAllocate();
+			assert(object != nullptr && "The object cache is full");
+
+			return object;
+		}
+
+		// Same as Allocate but returns nullptr when the pool has no slab left
+		T* TryAllocate()
+		{
+			LockGuard<TLock> guard(m_lock);
+
+			Slab* slab = m_partial.m_head;
+			if (slab == nullptr)
+			{
+				slab = m_empty.m_head != nullptr ? m_empty.m_head : CreateSlab();
+				if (slab == nullptr)
+				{
+					return nullptr;
+				}
+
+				MoveSlab(slab, m_empty, m_partial);
+			}
+
+			T* object = nullptr;
+			if (slab->m_freeNum > 0)
+			{
+				object = slab->m_objects + GetFreeIndices(slab)[--slab->m_freeNum];
+				TReset()(*object);
+			}
+			else
+			{
+				// Counted only once the constructor returns, an object whose constructor throws is not destroyed
+				object = new (slab->m_objects + slab->m_constructedNum) T();
+				++slab->m_constructedNum;
+			}
+
+			if (++slab->m_usedNum == m_objectsPerSlab)
+			{
+				MoveSlab(slab, m_partial, m_full);
+			}
+
+			return object;
+		}
+
+		void Free(T* object)
+		{
+			assert(m_slabPool.Contains(object) && "Object does not belong to the cache");
+
+			auto* slab = static_cast<Slab*>(m_slabPool.GetChunkStart(object));
+			const auto index = static_cast<std::uint32_t>(object - slab->m_objects);
+
+			LockGuard<TLock> guard(m_lock);
+
+			// Under the lock, TryAllocate may be constructing into the same slab
+			assert(index < slab->m_constructedNum && "Pointer must be an object of the cache");
+
+			GetFreeIndices(slab)[slab->m_freeNum++] = index;
+
+			if (slab->m_usedNum-- == m_objectsPerSlab)
+			{
+				MoveSlab(slab, m_full, slab->m_usedNum == 0 ? m_empty : m_partial);
+			}
+			else if (slab->m_usedNum == 0)
+			{
+				MoveSlab(slab, m_partial, m_empty);
+			}
+		}
+
+		// Destroys the objects of the empty slabs and returns the slabs to the pool
+		void Reap()
+		{
+			LockGuard<TLock> guard(m_lock);
+
+			DestroySlabs(m_empty);
+		}
+
+		std::size_t GetObjectsPerSlab() const
+		{
+			return m_objectsPerSlab;
+		}
+
+		std::size_t GetColorsNum() const
+		{
+			return m_colorsNum;
+		}
+
+		std::size_t GetPartialSlabsNum() const
+		{
+			return m_partial.m_slabsNum;
+		}
+
+		std::size_t GetFullSlabsNum() const
+		{
+			return m_full.m_slabsNum;
+		}
+
+		std::size_t GetEmptySlabsNum() const
+		{
+			return m_empty.m_slabsNum;
+		}
+
+	private:
+		// The objects start at a multiple of the cache line size from the slab start, after the header and the free
+		// indices. The pool arena comes from malloc, so the address itself is only aligned to alignof(std::max_align_t).
+		static std::size_t GetObjectsOffset(const std::size_t objectsNum)
+		{
+			const std::size_t metadataSize = sizeof(Slab) + objectsNum * sizeof(std::uint32_t);
+			return (metadataSize + cObjectCacheLineSize - 1) / cObjectCacheLineSize * cObjectCacheLineSize;
+		}
+
+		static std::uint32_t* GetFreeIndices(Slab* slab)
+		{
+			return reinterpret_cast<std::uint32_t*>(slab + 1);
+		}
+
+		Slab* CreateSlab()
+		{
+			void* chunk = m_slabPool.TryAllocate(m_slabPool.GetChunkSize());
+			if (chunk == nullptr)
+			{
+				return nullptr;
+			}
+
+			auto* slab = new (chunk) Slab{};
+			slab->m_objects = reinterpret_cast<T*>(PTR_TO_CHAR(chunk) + GetObjectsOffset(m_objectsPerSlab) +
+			                                       m_nextColor * cObjectCacheLineSize);
+			m_nextColor = (m_nextColor + 1) % m_colorsNum;
+
+			// Inserted in the empty list like the reused slabs, the caller moves it
+			InsertSlab(slab, m_empty);
+
+			return slab;
+		}
+
+		void DestroySlabs(SlabList& list)
+		{
+			while (Slab* slab = list.m_head)
+			{
+				RemoveSlab(slab, list);
+
+				for (std::uint32_t i = 0; i < slab->m_constructedNum; ++i)
+				{
+					slab->m_objects[i].~T();
+				}
+
+				m_slabPool.Free(slab);
+			}
+		}
+
+		static void InsertSlab(Slab* slab, SlabList& list)
+		{
+			slab->m_prev = nullptr;
+			slab->m_next = list.m_head;
+			if (list.m_head != nullptr)
+			{
+				list.m_head->m_prev = slab;
+			}
+
+			list.m_head = slab;
+			++list.m_slabsNum;
+		}
+
+		static void RemoveSlab(Slab* slab, SlabList& list)
+		{
+			if (slab->m_prev != nullptr)
+			{
+				slab->m_prev->m_next = slab->m_next;
+			}
+			else
+			{
+				list.m_head = slab->m_next;
+			}
+
+			if (slab->m_next != nullptr)
+			{
+				slab->m_next->m_prev = slab->m_prev;
+			}
+
+			--list.m_slabsNum;
+		}
+
+		static void MoveSlab(Slab* slab, SlabList& from, SlabList& to)
+		{
+			if (&from != &to)
+			{
+				RemoveSlab(slab, from);
+				InsertSlab(slab, to);
+			}
+		}
+
+	private:
+		PoolAllocator<NoLock, PoolFreeListMode::Intrusive> m_slabPool;
+		SlabList m_partial;
+		SlabList m_full;
+		SlabList m_empty;
+		std::size_t m_objectsPerSlab = 0;
+		std::size_t m_colorsNum = 1;
+		std::size_t m_nextColor = 0;
+		TLock m_lock;
+	};
+} // namespace MemAlloc
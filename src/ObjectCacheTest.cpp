@@ -0,0 +1,261 @@
+#include "ObjectCache.h"
+#include "PoolAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <mutex>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace MemAlloc;
+
+namespace
+{
+	struct CountedObject
+	{
+		static std::size_t sConstructedNum;
+		static std::size_t sDestroyedNum;
+		static std::size_t sResetNum;
+
+		CountedObject()
+		{
+			++sConstructedNum;
+		}
+
+		~CountedObject()
+		{
+			++sDestroyedNum;
+		}
+
+		std::size_t m_mark = 0;
+		char m_payload[192] = {}; // Leaves room for more than one color in a 4 KiB slab
+	};
+
+	std::size_t CountedObject::sConstructedNum = 0;
+	std::size_t CountedObject::sDestroyedNum = 0;
+	std::size_t CountedObject::sResetNum = 0;
+
+	struct CountedObjectReset
+	{
+		void operator()(CountedObject& object) const
+		{
+			object.m_mark = 0;
+			++CountedObject::sResetNum;
+		}
+	};
+
+	// An object with an expensive constructor: a mutex and a preallocated buffer
+	struct Connection
+	{
+		Connection() : m_buffer(4096)
+		{
+		}
+
+		std::mutex m_mutex;
+		std::vector<char> m_buffer;
+		std::size_t m_bytesUsed = 0;
+	};
+
+	struct ConnectionReset
+	{
+		void operator()(Connection& connection) const
+		{
+			connection.m_bytesUsed = 0;
+		}
+	};
+}
+
+static void RunTest()
+{
+	constexpr std::size_t roundsNum = 3;
+	constexpr std::size_t slabSize = 4096;
+
+	std::cout << "StartTest: ObjectCache\n";
+	std::cout << "Desc: Allocates objects(MaxChunksNum), marks them and deallocates in random order " << roundsNum << " times. Only the first round may run constructors, the others must only reset.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+
+	bool isPassed = true;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	{
+		ObjectCache<CountedObject, CountedObjectReset> cache(sMaxChunksNum, slabSize);
+		cache.Init();
+
+		const std::size_t objectsPerSlab = cache.GetObjectsPerSlab();
+		const std::size_t slabsNum = (sMaxChunksNum + objectsPerSlab - 1) / objectsPerSlab;
+
+		std::vector<CountedObject*> objects(sMaxChunksNum);
+		std::vector<std::size_t> freeOrder(sMaxChunksNum);
+		for (std::size_t i = 0; i < sMaxChunksNum; ++i)
+		{
+			freeOrder[i] = i;
+		}
+
+		for (std::size_t round = 0; round < roundsNum; ++round)
+		{
+			for (std::size_t i = 0; i < sMaxChunksNum; ++i)
+			{
+				objects[i] = cache.Allocate();
+				isPassed &= objects[i]->m_mark == 0;
+				objects[i]->m_mark = i + 1;
+			}
+
+			isPassed &= cache.GetFullSlabsNum() == sMaxChunksNum / objectsPerSlab;
+			isPassed &= cache.GetFullSlabsNum() + cache.GetPartialSlabsNum() == slabsNum;
+
+			// The slabs of the first round are handed out in address order, each one shifted by its color
+			if (round == 0)
+			{
+				std::set<std::size_t> colorOffsets;
+				const std::size_t coloredSlabsNum = std::min(cache.GetColorsNum(), slabsNum);
+				for (std::size_t i = 0; i < coloredSlabsNum; ++i)
+				{
+					colorOffsets.insert((PTR_TO_INT(objects[i * objectsPerSlab]) - PTR_TO_INT(objects[0])) % slabSize);
+				}
+				isPassed &= cache.GetColorsNum() > 1 && colorOffsets.size() == coloredSlabsNum;
+			}
+
+			std::shuffle(freeOrder.begin(), freeOrder.end(), std::mt19937(rand()));
+			for (const std::size_t idx : freeOrder)
+			{
+				isPassed &= objects[idx]->m_mark == idx + 1;
+				cache.Free(objects[idx]);
+			}
+
+			isPassed &= cache.GetEmptySlabsNum() == slabsNum;
+		}
+
+		// Each allocation either constructs or resets. The objects of a slab are constructed on first use, so the
+		// later rounds construct only the rest of the slab the first round left partial.
+		const std::size_t constructedNum = CountedObject::sConstructedNum;
+		isPassed &= constructedNum >= sMaxChunksNum && constructedNum <= slabsNum * objectsPerSlab;
+		isPassed &= constructedNum + CountedObject::sResetNum == roundsNum * sMaxChunksNum;
+
+		cache.Reap();
+		isPassed &= cache.GetEmptySlabsNum() == 0;
+		isPassed &= CountedObject::sDestroyedNum == constructedNum;
+
+		// A reaped slab is constructed again
+		cache.Free(cache.Allocate());
+		isPassed &= CountedObject::sConstructedNum == constructedNum + 1;
+	}
+
+	isPassed &= CountedObject::sDestroyedNum == CountedObject::sConstructedNum;
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (isPassed)
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+	else
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("ObjectCache       ", duration);
+}
+
+TEST_REGISTER(ObjectCacheTest, RunTest);
+
+// Each benchmark allocates state.range(0) connections and frees them in random order
+
+static std::vector<std::size_t> MakeFreeOrder(const std::size_t objectsNum)
+{
+	std::vector<std::size_t> freeOrder(objectsNum);
+	for (std::size_t i = 0; i < objectsNum; ++i)
+	{
+		freeOrder[i] = i;
+	}
+	std::shuffle(freeOrder.begin(), freeOrder.end(), std::mt19937(rand()));
+
+	return freeOrder;
+}
+
+static void BM_ConnectionNewDelete(benchmark::State& state)
+{
+	const std::size_t objectsNum = static_cast<std::size_t>(state.range(0));
+	const std::vector<std::size_t> freeOrder = MakeFreeOrder(objectsNum);
+	std::vector<Connection*> objects(objectsNum);
+
+	for (auto _ : state)
+	{
+		for (auto& object : objects)
+		{
+			object = new Connection();
+		}
+
+		for (const std::size_t idx : freeOrder)
+		{
+			delete objects[idx];
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * objectsNum);
+}
+
+BENCHMARK(BM_ConnectionNewDelete)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// Raw chunks: the constructor and the destructor run on every use
+static void BM_ConnectionPool(benchmark::State& state)
+{
+	const std::size_t objectsNum = static_cast<std::size_t>(state.range(0));
+	const std::vector<std::size_t> freeOrder = MakeFreeOrder(objectsNum);
+	std::vector<Connection*> objects(objectsNum);
+
+	PoolAllocator<> allocator(objectsNum, (sizeof(Connection) + sizeof(std::size_t) - 1) / sizeof(std::size_t) * sizeof(std::size_t));
+	allocator.Init();
+
+	for (auto _ : state)
+	{
+		for (auto& object : objects)
+		{
+			object = new (allocator.Allocate(sizeof(Connection))) Connection();
+		}
+
+		for (const std::size_t idx : freeOrder)
+		{
+			objects[idx]->~Connection();
+			allocator.Free(objects[idx]);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * objectsNum);
+}
+
+BENCHMARK(BM_ConnectionPool)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// Constructed once on the first iteration, only reset afterwards
+static void BM_ConnectionObjectCache(benchmark::State& state)
+{
+	const std::size_t objectsNum = static_cast<std::size_t>(state.range(0));
+	const std::vector<std::size_t> freeOrder = MakeFreeOrder(objectsNum);
+	std::vector<Connection*> objects(objectsNum);
+
+	// Leaves room for the slab headers and free indices
+	ObjectCache<Connection, ConnectionReset> cache(objectsNum * (sizeof(Connection) + sizeof(std::uint32_t)) / (cDefaultSlabSize / 2) + 1);
+	cache.Init();
+
+	for (auto _ : state)
+	{
+		for (auto& object : objects)
+		{
+			object = cache.Allocate();
+		}
+
+		for (const std::size_t idx : freeOrder)
+		{
+			cache.Free(objects[idx]);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * objectsNum);
+}
+
+BENCHMARK(BM_ConnectionObjectCache)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
\ No newline at end of file
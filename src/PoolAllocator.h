@@ -1,14 +1,28 @@
 #pragma once
 
 #include "AllocatorInterface.h"
+#include <algorithm>
 #include <cassert>
 
 namespace MemAlloc
 {
-	const ThreadPolicy cPoolAllocThreadPolicy(NONE);
+	enum class PoolFreeListMode
+	{
+		SideArray, // A separate array holds a pointer per free chunk
+		Intrusive // Each free chunk holds the pointer to the next one
+	};
 
+	// TLock is the locking policy of the instance, NoLock by default (see AllocatorInterface.h)
+	// In PoolFreeListMode::Intrusive the free chunks are linked through their first bytes and the chunks that were
+	// never allocated are handed out by bumping an index, so the metadata is O(1), Reset doesn't touch the chunks and
+	// Allocate reads only the chunk it returns, instead of a second cache line of the side array. The next chunk is
+	// known only once that read completes though, so draining a long list of cold chunks takes one cache miss after
+	// the other, while the side array lets the CPU fetch several chunks at once.
+	template <class TLock = NoLock, PoolFreeListMode TMode = PoolFreeListMode::SideArray>
 	class PoolAllocator final : public AllocatorInterface
 	{
+		static constexpr bool cIsIntrusive = TMode == PoolFreeListMode::Intrusive;
+
 	public:
 		PoolAllocator() = delete;
 
@@ -19,6 +33,8 @@ namespace MemAlloc
 			m_chunkSize = poolAllocator.m_chunkSize;
 			m_chunksNum = poolAllocator.m_chunksNum;
 			m_currFreeChunksIdx = poolAllocator.m_currFreeChunksIdx;
+			m_freeListHead = poolAllocator.m_freeListHead;
+			m_untouchedChunksIdx = poolAllocator.m_untouchedChunksIdx;
 		}
 
 		PoolAllocator(const std::size_t chunksNum, const std::size_t chunkSize)
@@ -31,7 +47,10 @@ namespace MemAlloc
 		void Init() override
 		{
 			m_start_ptr = static_cast<char*>(malloc(m_totalSize));
-			m_freeChunks = static_cast<char**>(malloc(m_chunksNum * sizeof(char*)));
+			if (!cIsIntrusive)
+			{
+				m_freeChunks = static_cast<char**>(malloc(m_chunksNum * sizeof(char*)));
+			}
 
 			Reset();
 		}
@@ -43,102 +62,171 @@ namespace MemAlloc
 		}
 
 		void* Allocate(const std::size_t allocationSize, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			void* dataAddress = TryAllocate(allocationSize, alignment);
+			assert(dataAddress != nullptr && "The pool allocator is full");
+
+			return dataAddress;
+		}
+
+		// Same as Allocate but returns nullptr when the pool is full
+		void* TryAllocate(const std::size_t allocationSize, const std::size_t alignment = sizeof(std::size_t))
 		{
 			assert(allocationSize <= m_chunkSize && "Allocation size must be <= to chunk size");
 
-			switch (cPoolAllocThreadPolicy)
+			LockGuard<TLock> guard(m_lock);
+
+			void* dataAddress = nullptr;
+			if (cIsIntrusive)
 			{
-			case ENABLE_SPIN_LOCK:
-				m_spinlock.lock();
-				break;
-			case NONE:
-				break;
+				dataAddress = PopFreeChunk();
+				if (dataAddress == nullptr)
+				{
+					return nullptr;
+				}
 			}
-
-			assert(m_currFreeChunksIdx >= 0 && "The pool allocator is full");			
-			if (m_currFreeChunksIdx < 0)
+			else
 			{
-				return nullptr;
+				if (m_currFreeChunksIdx < 0)
+				{
+					return nullptr;
+				}
+
+				dataAddress = m_freeChunks[m_currFreeChunksIdx--];
 			}
 
-			void* dataAddress = m_freeChunks[m_currFreeChunksIdx--];
-			
 			m_used += m_chunkSize;
 
 			assert(PTR_TO_INT(dataAddress) % alignment == 0 && "Data address must be aligment");
 
-			switch (cPoolAllocThreadPolicy)
-			{
-			case ENABLE_SPIN_LOCK:
-				m_spinlock.unlock();
-				break;
-			case NONE:
-				break;
-			}
-
 			return dataAddress;
 		}
 
 		bool Free(void* ptr) override
 		{
-			switch (cPoolAllocThreadPolicy)
-			{
-			case ENABLE_SPIN_LOCK:
-				m_spinlock.lock();
-				break;
-			case NONE:
-				break;
-			}
+			LockGuard<TLock> guard(m_lock);
 
-			if (ptr < m_start_ptr || ptr > m_start_ptr + m_totalSize)
+			if (!Contains(ptr))
 			{
 				return false;
 			}
 
 			m_used -= m_chunkSize;
 
-			m_freeChunks[++m_currFreeChunksIdx] = static_cast<char*>(ptr);
-
-			switch (cPoolAllocThreadPolicy)
+			if (cIsIntrusive)
 			{
-			case ENABLE_SPIN_LOCK:
-				m_spinlock.unlock();
-				break;
-			case NONE:
-				break;
+				*static_cast<char**>(ptr) = m_freeListHead;
+				m_freeListHead = static_cast<char*>(ptr);
+			}
+			else
+			{
+				m_freeChunks[++m_currFreeChunksIdx] = static_cast<char*>(ptr);
 			}
 
 			return true;
 		}
 
-		void Reset()
+		// Moves up to 'count' free chunks into 'chunks' under a single lock and prefetches them.
+		// Returns the number of chunks moved.
+		std::size_t AllocateBatch(const std::size_t count, void** chunks)
 		{
-			switch (cPoolAllocThreadPolicy)
+			std::size_t batchSize = 0;
+			{
+				LockGuard<TLock> guard(m_lock);
+
+				if (cIsIntrusive)
+				{
+					// Walking the list reads each chunk, the chunks that were never allocated are only prefetched
+					while (batchSize < count)
+					{
+						void* chunk = PopFreeChunk();
+						if (chunk == nullptr)
+						{
+							break;
+						}
+						chunks[batchSize++] = chunk;
+					}
+				}
+				else
+				{
+					const std::size_t freeChunksNum = static_cast<std::size_t>(m_currFreeChunksIdx + 1);
+					batchSize = count < freeChunksNum ? count : freeChunksNum;
+
+					// Take the whole run from the top of the free chunks stack
+					m_currFreeChunksIdx -= static_cast<int64_t>(batchSize);
+					char** run = m_freeChunks + m_currFreeChunksIdx + 1;
+					std::copy(run, run + batchSize, chunks);
+				}
+
+				m_used += batchSize * m_chunkSize;
+			}
+
+			for (std::size_t i = 0; i < batchSize; ++i)
 			{
-			case ENABLE_SPIN_LOCK:
-				m_spinlock.lock();
-				break;
-			case NONE:
-				break;
+				PrefetchForWrite(chunks[i]);
 			}
 
+			return batchSize;
+		}
+
+		// Returns 'count' chunks to the pool under a single lock. All chunks must belong to this pool.
+		void FreeBatch(void* const* chunks, const std::size_t count)
+		{
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				assert(Contains(chunks[i]) && "Chunk does not belong to the pool");
+			}
+
+			if (cIsIntrusive)
+			{
+				if (count == 0)
+				{
+					return;
+				}
+
+				// Links the batch outside of the lock and splices it in front of the list
+				for (std::size_t i = 0; i + 1 < count; ++i)
+				{
+					*static_cast<char**>(chunks[i]) = static_cast<char*>(chunks[i + 1]);
+				}
+
+				LockGuard<TLock> guard(m_lock);
+
+				*static_cast<char**>(chunks[count - 1]) = m_freeListHead;
+				m_freeListHead = static_cast<char*>(chunks[0]);
+
+				m_used -= count * m_chunkSize;
+				return;
+			}
+
+			LockGuard<TLock> guard(m_lock);
+
+			char** run = m_freeChunks + m_currFreeChunksIdx + 1;
+			std::transform(chunks, chunks + count, run, [](void* chunk) { return static_cast<char*>(chunk); });
+			m_currFreeChunksIdx += static_cast<int64_t>(count);
+
+			m_used -= count * m_chunkSize;
+		}
+
+		void Reset()
+		{
+			LockGuard<TLock> guard(m_lock);
+
 			m_used = 0;
 
+			if (cIsIntrusive)
+			{
+				m_freeListHead = nullptr;
+				m_untouchedChunksIdx = 0;
+				return;
+			}
+
 			for (std::size_t i = 0; i < m_chunksNum; ++i)
 			{
 				m_freeChunks[i] = m_start_ptr + (i)*m_chunkSize;
 			}
 
 			m_currFreeChunksIdx = static_cast<int64_t>(m_chunksNum) - 1;
-
-			switch (cPoolAllocThreadPolicy)
-			{
-			case ENABLE_SPIN_LOCK:
-				m_spinlock.unlock();
-				break;
-			case NONE:
-				break;
-			}
 		}
 
 		std::size_t GetChunkSize() const
@@ -146,12 +234,59 @@ namespace MemAlloc
 			return m_chunkSize;
 		}
 
+		bool Contains(const void* ptr) const
+		{
+			return ptr >= m_start_ptr && ptr < m_start_ptr + m_totalSize;
+		}
+
+		// Start of the chunk that holds ptr, for the callers that carve chunks into smaller pieces
+		void* GetChunkStart(const void* ptr) const
+		{
+			assert(Contains(ptr) && "Pointer does not belong to the pool");
+
+			const std::size_t offset = static_cast<std::size_t>(static_cast<const char*>(ptr) - m_start_ptr);
+			return m_start_ptr + offset - offset % m_chunkSize;
+		}
+
+		// Must be called after Init and before any chunk is allocated
+		void FirstTouch()
+		{
+			TouchPages(m_start_ptr, m_totalSize);
+		}
+
+		// Bytes of bookkeeping besides the instance itself
+		std::size_t GetMetadataSize() const
+		{
+			return cIsIntrusive ? 0 : m_chunksNum * sizeof(char*);
+		}
+
+	private:
+		// Intrusive mode: a freed chunk first, then a chunk that was never allocated
+		void* PopFreeChunk()
+		{
+			if (m_freeListHead != nullptr)
+			{
+				char* chunk = m_freeListHead;
+				m_freeListHead = *reinterpret_cast<char**>(chunk);
+				return chunk;
+			}
+
+			if (m_untouchedChunksIdx < m_chunksNum)
+			{
+				return m_start_ptr + m_untouchedChunksIdx++ * m_chunkSize;
+			}
+
+			return nullptr;
+		}
+
 	private:
 		char** m_freeChunks = nullptr;
 		char* m_start_ptr = nullptr;
 		std::size_t m_chunksNum = 0;
 		std::size_t m_chunkSize = 0;
 		int64_t m_currFreeChunksIdx = -1;
-		Spinlock m_spinlock;
+		char* m_freeListHead = nullptr; // Intrusive mode only
+		std::size_t m_untouchedChunksIdx = 0; // Intrusive mode only
+		TLock m_lock;
 	};
 } // namespace MemAlloc
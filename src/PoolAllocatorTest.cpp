@@ -1,13 +1,21 @@
+#include "Locks.h"
 #include "PoolAllocator.h"
+#include "SizeClassAllocator.h"
+#include "ThreadCachePoolAllocator.h"
 #include "Test.h"
 #include "benchmark/benchmark.h"
 
+#include <algorithm>
 #include <array>
+#include <condition_variable>
+#include <mutex>
+#include <random>
 #include <vector>
 
 using namespace MemAlloc;
 
 // Holds several pool allocator of different sizes
+template <class TLock = NoLock, PoolFreeListMode FreeListMode = PoolFreeListMode::SideArray>
 class PoolAllocators final
 {
 public:
@@ -59,6 +67,54 @@ public:
 		}
 	}
 
+	// Allocates 'count' chunks that fit 'size' with a single lock round trip
+	void AllocateBatch(uint32_t size, const std::size_t count, void** result)
+	{
+		std::size_t allocatedNum = 0;
+
+		for (auto& allocator : mAllocators)
+		{
+			if (size <= allocator.GetChunkSize())
+			{
+				allocatedNum = allocator.AllocateBatch(count, result);
+				break;
+			}
+		}
+
+		if (allocatedNum < count)
+		{
+			std::cout << "Warning[RedNetPhotonAllocator]: All allocators are full! Fallback to system call\n";
+			for (std::size_t i = allocatedNum; i < count; ++i)
+			{
+				result[i] = malloc(size);
+			}
+		}
+	}
+
+	// Frees each run of pointers that belong to the same pool with a single lock round trip
+	void FreeBatch(void* const* ptrs, const std::size_t count)
+	{
+		std::size_t i = 0;
+		while (i < count)
+		{
+			PoolAllocator<TLock, FreeListMode>* owner = FindOwner(ptrs[i]);
+			if (!owner)
+			{
+				free(ptrs[i++]);
+				continue;
+			}
+
+			std::size_t runEnd = i + 1;
+			while (runEnd < count && owner->Contains(ptrs[runEnd]))
+			{
+				++runEnd;
+			}
+
+			owner->FreeBatch(ptrs + i, runEnd - i);
+			i = runEnd;
+		}
+	}
+
 	uint32_t GetTotalSize() const
 	{
 		uint32_t totalSize = 0;
@@ -82,27 +138,43 @@ public:
 	}
 
 private:
-	std::array<PoolAllocator, 9> mAllocators = {
-		PoolAllocator(sMaxChunksNum, 64),
-		PoolAllocator(sMaxChunksNum, 128),
-		PoolAllocator(sMaxChunksNum, 256),
-		PoolAllocator(sMaxChunksNum, 512),
-		PoolAllocator(sMaxChunksNum, 1024),
-		PoolAllocator(sMaxChunksNum, 2048),
-		PoolAllocator(sMaxChunksNum, 3072),
-		PoolAllocator(sMaxChunksNum, 4096),
-		PoolAllocator(sMaxChunksNum, 5120)
+	PoolAllocator<TLock, FreeListMode>* FindOwner(const void* p)
+	{
+		for (auto& allocator : mAllocators)
+		{
+			if (allocator.Contains(p))
+			{
+				return &allocator;
+			}
+		}
+
+		return nullptr;
+	}
+
+	std::array<PoolAllocator<TLock, FreeListMode>, 9> mAllocators = {
+		PoolAllocator<TLock, FreeListMode>(sMaxChunksNum, 64),
+		PoolAllocator<TLock, FreeListMode>(sMaxChunksNum, 128),
+		PoolAllocator<TLock, FreeListMode>(sMaxChunksNum, 256),
+		PoolAllocator<TLock, FreeListMode>(sMaxChunksNum, 512),
+		PoolAllocator<TLock, FreeListMode>(sMaxChunksNum, 1024),
+		PoolAllocator<TLock, FreeListMode>(sMaxChunksNum, 2048),
+		PoolAllocator<TLock, FreeListMode>(sMaxChunksNum, 3072),
+		PoolAllocator<TLock, FreeListMode>(sMaxChunksNum, 4096),
+		PoolAllocator<TLock, FreeListMode>(sMaxChunksNum, 5120)
 	};
 };
 
+template <PoolFreeListMode FreeListMode>
 static void RunTest()
 {
-	std::cout << "StartTest: PoolAllocator\n";
+	const bool isIntrusive = FreeListMode == PoolFreeListMode::Intrusive;
+
+	std::cout << "StartTest: PoolAllocator" << (isIntrusive ? " intrusive" : "") << "\n";
 	std::cout << "Desc: Creates 9 pool allocators of different chunk size. Allocates chunks(MaxChunksNum) of size = 'rand() % sMaxChunkSize + 1'. Deallocates in random order.\n";
 	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
 	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
 
-	PoolAllocators allocators;
+	PoolAllocators<NoLock, FreeListMode> allocators;
 
 	std::vector<void*> memPointers;
 	memPointers.reserve(sMaxChunksNum);
@@ -137,24 +209,73 @@ static void RunTest()
 		std::cout << green << "Test Passed!\n" << white;
 	}
 
-	Test::GetTestResults().emplace("PoolAllocator     ", duration);
+	Test::GetTestResults().emplace(isIntrusive ? "PoolIntrusive     " : "PoolAllocator     ", duration);
 }
 
-TEST_REGISTER(PoolAllocatorTest, RunTest);
+TEST_REGISTER(PoolAllocatorTest, RunTest<PoolFreeListMode::SideArray>);
+TEST_REGISTER(PoolAllocatorIntrusiveTest, RunTest<PoolFreeListMode::Intrusive>);
 
-static void RunMultiThreadTest()
+template <PoolFreeListMode FreeListMode>
+static void RunBatchTest()
 {
-	if(cPoolAllocThreadPolicy == NONE)
+	constexpr std::size_t maxBatchSize = 32;
+	const bool isIntrusive = FreeListMode == PoolFreeListMode::Intrusive;
+
+	std::cout << "StartTest: PoolAllocator" << (isIntrusive ? " intrusive" : "") << " batch\n";
+	std::cout << "Desc: Creates 9 pool allocators of different chunk size. Allocates chunks(MaxChunksNum) in batches of 'rand() % " << maxBatchSize << " + 1' chunks of size = 'rand() % sMaxChunkSize + 1'. Deallocates in batches in random order.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
+
+	PoolAllocators<NoLock, FreeListMode> allocators;
+
+	std::vector<void*> memPointers(sMaxChunksNum);
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	for (std::size_t i = 0; i < sMaxChunksNum;)
 	{
-		return;
+		const std::size_t batchSize = std::min<std::size_t>(rand() % maxBatchSize + 1, sMaxChunksNum - i);
+		allocators.AllocateBatch(rand() % sMaxChunkSize + 1, batchSize, memPointers.data() + i);
+		i += batchSize;
 	}
 
+	std::shuffle(memPointers.begin(), memPointers.end(), std::mt19937(rand()));
+
+	for (std::size_t i = 0; i < sMaxChunksNum;)
+	{
+		const std::size_t batchSize = std::min<std::size_t>(rand() % maxBatchSize + 1, sMaxChunksNum - i);
+		allocators.FreeBatch(memPointers.data() + i, batchSize);
+		i += batchSize;
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (allocators.GetUsedSize() > 0)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace(isIntrusive ? "PoolIntrusiveBatch" : "PoolAllocatorBatch", duration);
+}
+
+TEST_REGISTER(PoolAllocatorBatchTest, RunBatchTest<PoolFreeListMode::SideArray>);
+TEST_REGISTER(PoolAllocatorIntrusiveBatchTest, RunBatchTest<PoolFreeListMode::Intrusive>);
+
+static void RunMultiThreadTest()
+{
 	std::cout << "StartMultiThreadTest: PoolAllocator\n";
 	std::cout << "Desc: Creates 9 pool allocators of different chunk size. Create 2 threads. Each thread allocates chunks(MaxChunksNum) of size = 'rand() % sMaxChunkSize + 1'. Deallocates in random order.\n";
 	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
 	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
 
-	PoolAllocators allocators;
+	PoolAllocators<Spinlock> allocators;
 
 	auto threadFunc = [&allocators](){
 		std::vector<void*> memPointers;
@@ -203,9 +324,264 @@ static void RunMultiThreadTest()
 
 TEST_REGISTER(PoolAllocatorMultiTest, RunMultiThreadTest);
 
+template <PoolCacheMode CacheMode>
+static void RunThreadCacheTest()
+{
+	constexpr std::size_t threadsNum = 4;
+	constexpr bool isPerCpu = CacheMode == PoolCacheMode::PerCpu;
+
+	std::cout << "StartMultiThreadTest: ThreadCachePoolAllocator" << (isPerCpu ? " per-CPU" : "") << "\n";
+	std::cout << "Desc: Creates a pool allocator with per-" << (isPerCpu ? "CPU" : "thread") << " caches. Create " << threadsNum << " threads. Each thread allocates chunks(MaxChunksNum / " << threadsNum << ") of 64 bytes, marks them and deallocates in random order.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+
+	// Thread caches may park up to cThreadCacheCapacity chunks per thread on top of the live ones
+	ThreadCachePoolAllocator allocator(sMaxChunksNum + threadsNum * cThreadCacheCapacity, 64, true, CacheMode);
+	allocator.Init();
+
+	std::atomic<bool> corrupted{false};
+
+	auto threadFunc = [&allocator, &corrupted](const std::size_t threadIdx){
+		std::vector<void*> memPointers;
+		memPointers.reserve(sMaxChunksNum / threadsNum);
+
+		for (std::size_t i = 0; i < sMaxChunksNum / threadsNum; ++i)
+		{
+			auto* p = static_cast<std::size_t*>(allocator.Allocate(sizeof(std::size_t)));
+			*p = threadIdx;
+			memPointers.emplace_back(p);
+		}
+
+		const std::size_t memPointersNum = memPointers.size();
+		for (int i = static_cast<int>(memPointersNum) - 1; i >= 0; --i)
+		{
+			const auto idx = (i != 0 ? rand() % i : 0);
+			if (*static_cast<std::size_t*>(memPointers[idx]) != threadIdx)
+			{
+				corrupted = true;
+			}
+			allocator.Free(memPointers[idx]);
+			memPointers.erase(memPointers.begin() + idx);
+		}
+	};
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < threadsNum; ++i)
+	{
+		threads.emplace_back(threadFunc, i);
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	// Exited threads must have returned their cached chunks, CPU caches outlive them
+	allocator.FlushCpuCaches();
+	if (allocator.GetUsedSize() > 0 || corrupted)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace(isPerCpu ? "PoolCpuCache4T    " : "PoolThreadCache4T ", duration);
+}
+
+TEST_REGISTER(ThreadCachePoolAllocatorTest, RunThreadCacheTest<PoolCacheMode::PerThread>);
+TEST_REGISTER(CpuCachePoolAllocatorTest, RunThreadCacheTest<PoolCacheMode::PerCpu>);
+
+static void RunThreadCacheStealTest()
+{
+	constexpr std::size_t chunksNum = 4 * cThreadCacheCapacity;
+
+	std::cout << "StartMultiThreadTest: ThreadCachePoolAllocator work stealing\n";
+	std::cout << "Desc: Creates a pool allocator with per-thread caches of " << chunksNum << " chunks. The first thread allocates every chunk, the second one frees them all and keeps its cache while the third one allocates every chunk again.\n";
+
+	ThreadCachePoolAllocator allocator(chunksNum, 64);
+	allocator.Init();
+
+	std::vector<void*> memPointers(chunksNum);
+	std::size_t allocatedNum = 0;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::thread([&allocator, &memPointers](){
+		for (auto& p : memPointers)
+		{
+			p = allocator.Allocate(64);
+		}
+		allocator.FlushThreadCache();
+	}).join();
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool freed = false;
+	bool allocated = false;
+
+	// Hoards up to cThreadCacheCapacity chunks in its cache until the allocating thread is done
+	std::thread hoarder([&](){
+		for (auto* p : memPointers)
+		{
+			allocator.Free(p);
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		freed = true;
+		condition.notify_all();
+		condition.wait(lock, [&allocated](){ return allocated; });
+	});
+
+	std::thread([&](){
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [&freed](){ return freed; });
+		}
+
+		for (auto& p : memPointers)
+		{
+			p = allocator.TryAllocate(64);
+			allocatedNum += (p != nullptr ? 1 : 0);
+		}
+
+		for (auto* p : memPointers)
+		{
+			allocator.Free(p);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		allocated = true;
+		condition.notify_all();
+	}).join();
+
+	hoarder.join();
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (allocatedNum != chunksNum || allocator.GetUsedSize() > 0)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("PoolThreadCacheStl", duration);
+}
+
+TEST_REGISTER(ThreadCachePoolAllocatorStealTest, RunThreadCacheStealTest);
+
+static void RunThreadCacheStealManyTest()
+{
+	constexpr std::size_t victimsNum = 4;
+	constexpr std::size_t chunksNum = victimsNum * cThreadCacheCapacity;
+
+	std::cout << "StartMultiThreadTest: ThreadCachePoolAllocator work stealing from many caches\n";
+	std::cout << "Desc: Creates a pool allocator with per-thread caches of " << chunksNum << " chunks. " << victimsNum << " threads free " << cThreadCacheCapacity << " chunks each and keep their full caches while another thread allocates every chunk again.\n";
+
+	ThreadCachePoolAllocator allocator(chunksNum, 64);
+	allocator.Init();
+
+	std::vector<void*> memPointers(chunksNum);
+	std::size_t allocatedNum = 0;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::thread([&allocator, &memPointers](){
+		for (auto& p : memPointers)
+		{
+			p = allocator.Allocate(64);
+		}
+		allocator.FlushThreadCache();
+	}).join();
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::size_t freedNum = 0;
+	bool allocated = false;
+
+	// Each victim fills its cache exactly, so the shared pool stays empty
+	std::vector<std::thread> victims;
+	for (std::size_t i = 0; i < victimsNum; ++i)
+	{
+		victims.emplace_back([&, i](){
+			for (std::size_t j = 0; j < cThreadCacheCapacity; ++j)
+			{
+				allocator.Free(memPointers[i * cThreadCacheCapacity + j]);
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			++freedNum;
+			condition.notify_all();
+			condition.wait(lock, [&allocated](){ return allocated; });
+		});
+	}
+
+	// The halves of the victims add up to more than the thief's cache holds
+	std::thread([&](){
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [&freedNum](){ return freedNum == victimsNum; });
+		}
+
+		for (auto& p : memPointers)
+		{
+			p = allocator.TryAllocate(64);
+			allocatedNum += (p != nullptr ? 1 : 0);
+		}
+
+		for (auto* p : memPointers)
+		{
+			if (p != nullptr)
+			{
+				allocator.Free(p);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		allocated = true;
+		condition.notify_all();
+	}).join();
+
+	for (auto& victim : victims)
+	{
+		victim.join();
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (allocatedNum != chunksNum || allocator.GetUsedSize() > 0)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("PoolCacheStealMany", duration);
+}
+
+TEST_REGISTER(ThreadCachePoolAllocatorStealManyTest, RunThreadCacheStealManyTest);
+
 static void BM_PoolAlloc(benchmark::State& state)
 {
-	PoolAllocators allocators;
+	PoolAllocators<> allocators;
 
 	for (auto _ : state)
 	{
@@ -216,4 +592,379 @@ static void BM_PoolAlloc(benchmark::State& state)
 	state.SetBytesProcessed(state.iterations());
 }
 
-BENCHMARK(BM_PoolAlloc);
\ No newline at end of file
+BENCHMARK(BM_PoolAlloc);
+
+// Allocates and frees random sizes up to state.range(0). PoolAllocators searches its pools on Allocate and probes
+// their ranges on Free, so the cost grows with the size, SizeClassAllocator computes the class and the owner.
+template <class TAllocators>
+static void RunRandomSizes(TAllocators& allocators, benchmark::State& state)
+{
+	std::vector<uint32_t> sizes(1024);
+	for (auto& size : sizes)
+	{
+		size = rand() % state.range(0) + 1;
+	}
+
+	std::size_t sizeIdx = 0;
+	for (auto _ : state)
+	{
+		auto* p = allocators.Allocate(sizes[sizeIdx]);
+		benchmark::DoNotOptimize(p);
+		allocators.Free(p);
+
+		sizeIdx = (sizeIdx + 1) % sizes.size();
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_PoolAllocRandomSize(benchmark::State& state)
+{
+	PoolAllocators<> allocators;
+	RunRandomSizes(allocators, state);
+}
+
+BENCHMARK(BM_PoolAllocRandomSize)->Arg(64)->Arg(1024)->Arg(5120);
+
+static void BM_SizeClassAllocRandomSize(benchmark::State& state)
+{
+	SizeClassAllocator<> allocator(64 * 1024, sMaxChunkSize);
+	allocator.Init();
+	RunRandomSizes(allocator, state);
+}
+
+BENCHMARK(BM_SizeClassAllocRandomSize)->Arg(64)->Arg(1024)->Arg(5120);
+
+// Reuses state.range(0) chunks of 64 bytes in random order: allocates and writes all of them, frees them shuffled.
+// Above L2 every chunk is a cache miss. The intrusive list learns the next head only by loading the chunk it
+// returns, so its misses happen one after another. The side array reads the next index from a dense array of
+// 8 bytes per chunk and the misses of the chunks overlap, which makes it several times faster at 1M chunks.
+template <PoolFreeListMode FreeListMode>
+static void BM_PoolRandomReuse(benchmark::State& state)
+{
+	const std::size_t chunksNum = static_cast<std::size_t>(state.range(0));
+
+	PoolAllocator<NoLock, FreeListMode> allocator(chunksNum, 64);
+	allocator.Init();
+
+	std::vector<void*> memPointers(chunksNum);
+	for (auto& p : memPointers)
+	{
+		p = allocator.Allocate(64);
+	}
+	std::shuffle(memPointers.begin(), memPointers.end(), std::mt19937(rand()));
+	for (void* p : memPointers)
+	{
+		allocator.Free(p);
+	}
+
+	std::vector<std::size_t> freeOrder(chunksNum);
+	for (std::size_t i = 0; i < chunksNum; ++i)
+	{
+		freeOrder[i] = i;
+	}
+	std::shuffle(freeOrder.begin(), freeOrder.end(), std::mt19937(rand()));
+
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < chunksNum; ++i)
+		{
+			memPointers[i] = allocator.Allocate(64);
+			*static_cast<std::size_t*>(memPointers[i]) = i;
+		}
+
+		for (const std::size_t idx : freeOrder)
+		{
+			allocator.Free(memPointers[idx]);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * chunksNum);
+	state.counters["MetadataBytes"] = static_cast<double>(allocator.GetMetadataSize());
+}
+
+// 4K chunks fit in L2, 1M chunks take 64 MiB
+BENCHMARK_TEMPLATE(BM_PoolRandomReuse, PoolFreeListMode::SideArray)->Arg(4096)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_PoolRandomReuse, PoolFreeListMode::Intrusive)->Arg(4096)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+
+// Keeps state.range(0) chunks of 64 bytes live, each iteration frees a random one and allocates and writes
+// a replacement, which reuses the chunk that was just freed
+template <PoolFreeListMode FreeListMode>
+static void BM_PoolChurn(benchmark::State& state)
+{
+	const std::size_t chunksNum = static_cast<std::size_t>(state.range(0));
+
+	PoolAllocator<NoLock, FreeListMode> allocator(chunksNum, 64);
+	allocator.Init();
+
+	std::vector<void*> memPointers(chunksNum);
+	for (auto& p : memPointers)
+	{
+		p = allocator.Allocate(64);
+	}
+
+	std::vector<std::size_t> indices(1024);
+	for (auto& idx : indices)
+	{
+		idx = rand() % chunksNum;
+	}
+
+	std::size_t i = 0;
+	for (auto _ : state)
+	{
+		const std::size_t idx = indices[i++ % indices.size()];
+		allocator.Free(memPointers[idx]);
+		memPointers[idx] = allocator.Allocate(64);
+		*static_cast<std::size_t*>(memPointers[idx]) = idx;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_PoolChurn, PoolFreeListMode::SideArray)->Arg(4096)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_PoolChurn, PoolFreeListMode::Intrusive)->Arg(4096)->Arg(1 << 20);
+
+// Allocates and frees range(0) chunks per iteration with one call each way, compare with BM_PoolAllocLoop
+static void BM_PoolAllocBatch(benchmark::State& state)
+{
+	PoolAllocators<Spinlock> allocators;
+	const std::size_t batchSize = static_cast<std::size_t>(state.range(0));
+	std::vector<void*> memPointers(batchSize);
+
+	for (auto _ : state)
+	{
+		allocators.AllocateBatch(64, batchSize, memPointers.data());
+		benchmark::DoNotOptimize(memPointers.data());
+		allocators.FreeBatch(memPointers.data(), batchSize);
+	}
+
+	state.SetItemsProcessed(state.iterations() * batchSize);
+}
+
+BENCHMARK(BM_PoolAllocBatch)->RangeMultiplier(2)->Range(1, 64);
+
+static void BM_PoolAllocLoop(benchmark::State& state)
+{
+	PoolAllocators<Spinlock> allocators;
+	const std::size_t batchSize = static_cast<std::size_t>(state.range(0));
+	std::vector<void*> memPointers(batchSize);
+
+	for (auto _ : state)
+	{
+		for (auto& p : memPointers)
+		{
+			p = allocators.Allocate(64);
+		}
+		benchmark::DoNotOptimize(memPointers.data());
+		for (auto* p : memPointers)
+		{
+			allocators.Free(p);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * batchSize);
+}
+
+BENCHMARK(BM_PoolAllocLoop)->RangeMultiplier(2)->Range(1, 64);
+
+// Shared pool locked on every call
+template <class TLock>
+static void BM_PoolAllocThreads(benchmark::State& state)
+{
+	static PoolAllocator<TLock>* sSharedPool = nullptr;
+
+	if (state.thread_index() == 0)
+	{
+		sSharedPool = new PoolAllocator<TLock>(sMaxChunksNum, 64);
+		sSharedPool->Init();
+	}
+
+	for (auto _ : state)
+	{
+		auto* p = sSharedPool->Allocate(1);
+		benchmark::DoNotOptimize(p);
+		sSharedPool->Free(p);
+	}
+
+	state.SetBytesProcessed(state.iterations());
+
+	if (state.thread_index() == 0)
+	{
+		delete sSharedPool;
+		sSharedPool = nullptr;
+	}
+}
+
+BENCHMARK_TEMPLATE(BM_PoolAllocThreads, Spinlock)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PoolAllocThreads, std::mutex)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PoolAllocThreads, TicketLock)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PoolAllocThreads, McsLock)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PoolAllocThreads, AdaptiveLock)->ThreadRange(1, 16)->UseRealTime();
+
+static ThreadCachePoolAllocator* sThreadCachePool = nullptr;
+
+static void BM_ThreadCachePoolAlloc(benchmark::State& state)
+{
+	if (state.thread_index() == 0)
+	{
+		sThreadCachePool = new ThreadCachePoolAllocator(sMaxChunksNum, 64);
+		sThreadCachePool->Init();
+	}
+
+	for (auto _ : state)
+	{
+		auto* p = sThreadCachePool->Allocate(1);
+		benchmark::DoNotOptimize(p);
+		sThreadCachePool->Free(p);
+	}
+
+	state.SetBytesProcessed(state.iterations());
+
+	if (state.thread_index() == 0)
+	{
+		delete sThreadCachePool;
+		sThreadCachePool = nullptr;
+	}
+}
+
+BENCHMARK(BM_ThreadCachePoolAlloc)->ThreadRange(1, 16)->UseRealTime();
+
+static std::atomic<bool> sFootprintMeasured{false};
+
+// Every thread allocates a burst of chunks and frees it. 'cached_bytes' is what the caches hold after the run,
+// while the threads are still alive.
+template <PoolCacheMode CacheMode>
+static void BM_PoolCacheFootprint(benchmark::State& state)
+{
+	constexpr std::size_t burstSize = 8;
+
+	if (state.thread_index() == 0)
+	{
+		sThreadCachePool = new ThreadCachePoolAllocator(sMaxChunksNum * 8, 64, true, CacheMode);
+		sThreadCachePool->Init();
+		sFootprintMeasured = false;
+	}
+
+	void* memPointers[burstSize];
+
+	for (auto _ : state)
+	{
+		for (auto& p : memPointers)
+		{
+			p = sThreadCachePool->Allocate(64);
+		}
+		benchmark::DoNotOptimize(memPointers);
+		for (auto* p : memPointers)
+		{
+			sThreadCachePool->Free(p);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * burstSize);
+
+	if (state.thread_index() != 0)
+	{
+		// Exiting threads would flush their caches before they are measured
+		while (!sFootprintMeasured)
+		{
+			std::this_thread::yield();
+		}
+	}
+	else
+	{
+		state.counters["cached_bytes"] = static_cast<double>(sThreadCachePool->GetUsedSize());
+		sFootprintMeasured = true;
+
+		delete sThreadCachePool;
+		sThreadCachePool = nullptr;
+	}
+}
+
+BENCHMARK_TEMPLATE(BM_PoolCacheFootprint, PoolCacheMode::PerThread)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PoolCacheFootprint, PoolCacheMode::PerCpu)->ThreadRange(1, 64)->UseRealTime();
+
+static ThreadCachePoolAllocator* sSkewedThreadCachePool = nullptr;
+static std::mutex sSkewedHandoffMutex;
+static std::vector<void*> sSkewedHandoff;
+
+// Thread 0 allocates chunks and hands them over to the other threads, which only free them.
+// The pool has one and a half refill batches per thread, so without stealing the hoarding consumers push the producer to malloc.
+template <bool WorkStealing>
+static void BM_ThreadCacheSkewed(benchmark::State& state)
+{
+	if (state.thread_index() == 0)
+	{
+		sSkewedThreadCachePool = new ThreadCachePoolAllocator(state.threads() * cThreadCacheBatchSize * 3 / 2, 64, WorkStealing);
+		sSkewedThreadCachePool->Init();
+	}
+
+	std::size_t fallbacksNum = 0;
+	std::vector<void*> memPointers;
+
+	for (auto _ : state)
+	{
+		if (state.thread_index() == 0)
+		{
+			// Keeps at most a batch of chunks in flight, so that the pool can't run out because of the handoff itself
+			{
+				std::lock_guard<std::mutex> lock(sSkewedHandoffMutex);
+				if (sSkewedHandoff.size() >= cThreadCacheBatchSize)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+			}
+
+			void* p = sSkewedThreadCachePool->TryAllocate(64);
+			if (p == nullptr)
+			{
+				p = malloc(64);
+				++fallbacksNum;
+			}
+
+			std::lock_guard<std::mutex> lock(sSkewedHandoffMutex);
+			sSkewedHandoff.push_back(p);
+		}
+		else
+		{
+			{
+				std::lock_guard<std::mutex> lock(sSkewedHandoffMutex);
+				memPointers.swap(sSkewedHandoff);
+			}
+
+			if (memPointers.empty())
+			{
+				std::this_thread::yield();
+			}
+
+			for (auto* p : memPointers)
+			{
+				if (!sSkewedThreadCachePool->Free(p))
+				{
+					free(p);
+				}
+			}
+			memPointers.clear();
+		}
+	}
+
+	state.counters["malloc_fallbacks"] = static_cast<double>(fallbacksNum);
+
+	if (state.thread_index() == 0)
+	{
+		for (auto* p : sSkewedHandoff)
+		{
+			if (!sSkewedThreadCachePool->Free(p))
+			{
+				free(p);
+			}
+		}
+		sSkewedHandoff.clear();
+
+		delete sSkewedThreadCachePool;
+		sSkewedThreadCachePool = nullptr;
+	}
+}
+
+BENCHMARK_TEMPLATE(BM_ThreadCacheSkewed, false)->ThreadRange(2, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ThreadCacheSkewed, true)->ThreadRange(2, 8)->UseRealTime();
\ No newline at end of file
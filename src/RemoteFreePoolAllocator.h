@@ -0,0 +1,116 @@
+#pragma once
+
+#include "PoolAllocator.h"
+#include <new>
+
+namespace MemAlloc
+{
+	constexpr std::size_t cRemoteFreeBatchSize = 64;
+
+	// Pool allocator owned by a single thread, the one that called Init().
+	// The owner allocates and frees without any lock. Other threads never touch the pool itself: they push freed
+	// chunks onto a wait-free MPSC "remote free" queue, and the owner moves them back to the pool in bulk
+	// the next time it runs out of chunks.
+	class RemoteFreePoolAllocator final : public AllocatorInterface
+	{
+	public:
+		RemoteFreePoolAllocator() = delete;
+		RemoteFreePoolAllocator(const RemoteFreePoolAllocator&) = delete;
+
+		RemoteFreePoolAllocator(const std::size_t chunksNum, const std::size_t chunkSize)
+			: AllocatorInterface(chunksNum * chunkSize), m_pool(chunksNum, chunkSize)
+		{
+			assert(chunkSize >= sizeof(MpscQueue::Node) && "Chunk must fit a queue node");
+		}
+
+		// The calling thread becomes the owner
+		void Init() override
+		{
+			m_ownerId = std::this_thread::get_id();
+			m_pool.Init();
+		}
+
+		// Must be called by the owner
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			assert(IsOwner() && "Only the owner thread allocates");
+
+			void* dataAddress = m_pool.TryAllocate(size, alignment);
+
+			// A remote Free may still be linking its chunk, which pop() can't return yet, so keep draining until
+			// the queue is really empty rather than report a full pool
+			while (dataAddress == nullptr)
+			{
+				DrainRemoteFrees();
+				dataAddress = m_pool.TryAllocate(size, alignment);
+				if (dataAddress == nullptr && m_remoteFrees.empty())
+				{
+					break;
+				}
+			}
+			assert(dataAddress != nullptr && "The pool allocator is full");
+
+			return dataAddress;
+		}
+
+		// May be called by any thread
+		bool Free(void* ptr) override
+		{
+			if (!m_pool.Contains(ptr))
+			{
+				return false;
+			}
+
+			if (IsOwner())
+			{
+				return m_pool.Free(ptr);
+			}
+
+			m_remoteFrees.push(new (ptr) MpscQueue::Node());
+
+			return true;
+		}
+
+		// Must be called by the owner. Returns the chunks freed by other threads to the pool.
+		void DrainRemoteFrees()
+		{
+			assert(IsOwner() && "Only the owner thread drains remote frees");
+
+			void* chunks[cRemoteFreeBatchSize];
+			std::size_t count = 0;
+
+			while (MpscQueue::Node* node = m_remoteFrees.pop())
+			{
+				chunks[count++] = node;
+				if (count == cRemoteFreeBatchSize)
+				{
+					m_pool.FreeBatch(chunks, count);
+					count = 0;
+				}
+			}
+
+			m_pool.FreeBatch(chunks, count);
+		}
+
+		// Chunks waiting in the remote free queue are counted as used
+		std::size_t GetUsedSize() const override
+		{
+			return m_pool.GetUsedSize();
+		}
+
+		std::size_t GetChunkSize() const
+		{
+			return m_pool.GetChunkSize();
+		}
+
+		bool IsOwner() const
+		{
+			return std::this_thread::get_id() == m_ownerId;
+		}
+
+	private:
+		PoolAllocator<> m_pool;
+		std::thread::id m_ownerId;
+		MpscQueue m_remoteFrees;
+	};
+} // namespace MemAlloc
@@ -0,0 +1,179 @@
+#include "RemoteFreePoolAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <array>
+
+using namespace MemAlloc;
+
+// Hands chunks over from a producer thread to a consumer thread
+struct ChunksRing final
+{
+	static constexpr std::size_t cCapacity = 256;
+
+	bool IsFull() const
+	{
+		return m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_acquire) == cCapacity;
+	}
+
+	bool Push(void* chunk)
+	{
+		const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) == cCapacity)
+		{
+			return false;
+		}
+
+		m_chunks[tail % cCapacity] = chunk;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	void* Pop()
+	{
+		const std::size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+		{
+			return nullptr;
+		}
+
+		void* chunk = m_chunks[head % cCapacity];
+		m_head.store(head + 1, std::memory_order_release);
+		return chunk;
+	}
+
+	std::array<void*, cCapacity> m_chunks{};
+	alignas(64) std::atomic<std::size_t> m_head{0};
+	alignas(64) std::atomic<std::size_t> m_tail{0};
+};
+
+static void RunTest()
+{
+	const std::size_t itemsNum = 3 * sMaxChunksNum;
+
+	std::cout << "StartMultiThreadTest: RemoteFreePoolAllocator\n";
+	std::cout << "Desc: Creates a pool allocator owned by a producer thread. The producer allocates " << itemsNum << " chunks of 64 bytes and passes them to a consumer thread that deallocates them.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+
+	RemoteFreePoolAllocator allocator(sMaxChunksNum, 64);
+	ChunksRing ring;
+	std::atomic<bool> consumerDone{false};
+	std::atomic<bool> corrupted{false};
+
+	auto producerFunc = [&](){
+		allocator.Init();
+
+		for (std::size_t i = 0; i < itemsNum; ++i)
+		{
+			auto* p = static_cast<std::size_t*>(allocator.Allocate(sizeof(std::size_t)));
+			*p = i;
+			while (!ring.Push(p))
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		while (!consumerDone)
+		{
+			std::this_thread::yield();
+		}
+
+		allocator.DrainRemoteFrees();
+	};
+
+	auto consumerFunc = [&](){
+		for (std::size_t i = 0; i < itemsNum; ++i)
+		{
+			void* p = nullptr;
+			while ((p = ring.Pop()) == nullptr)
+			{
+				std::this_thread::yield();
+			}
+
+			if (*static_cast<std::size_t*>(p) != i)
+			{
+				corrupted = true;
+			}
+			allocator.Free(p);
+		}
+
+		consumerDone = true;
+	};
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::thread producer(producerFunc);
+	std::thread consumer(consumerFunc);
+
+	producer.join();
+	consumer.join();
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (allocator.GetUsedSize() > 0 || corrupted)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("RemoteFreePool    ", duration);
+}
+
+TEST_REGISTER(RemoteFreePoolAllocatorTest, RunTest);
+
+// Thread 0 allocates and passes chunks to thread 1, which frees them
+template <class TAllocator>
+static void BM_ProducerConsumer(benchmark::State& state)
+{
+	static TAllocator* sAllocator = nullptr;
+	static ChunksRing* sRing = nullptr;
+
+	if (state.thread_index() == 0)
+	{
+		sAllocator = new TAllocator(sMaxChunksNum, 64);
+		sAllocator->Init();
+		sRing = new ChunksRing();
+	}
+
+	std::size_t consumed = 0;
+
+	for (auto _ : state)
+	{
+		if (state.thread_index() == 0)
+		{
+			if (!sRing->IsFull())
+			{
+				sRing->Push(sAllocator->Allocate(1));
+			}
+		}
+		else if (void* p = sRing->Pop())
+		{
+			sAllocator->Free(p);
+			++consumed;
+		}
+	}
+
+	state.SetItemsProcessed(consumed);
+
+	if (state.thread_index() == 0)
+	{
+		while (void* p = sRing->Pop())
+		{
+			sAllocator->Free(p);
+		}
+
+		delete sRing;
+		delete sAllocator;
+		sRing = nullptr;
+		sAllocator = nullptr;
+	}
+}
+
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, RemoteFreePoolAllocator)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ProducerConsumer, PoolAllocator<Spinlock>)->Threads(2)->UseRealTime();
\ No newline at end of file
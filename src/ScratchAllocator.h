@@ -0,0 +1,136 @@
+#pragma once
+
+#include "StackAllocator.h"
+#include <memory>
+
+namespace MemAlloc
+{
+	constexpr std::size_t cDefaultScratchCapacity = 256 * 1024; // 256KiB
+
+	// Per-thread scratch memory for temporaries, backed by a thread_local StackAllocator.
+	// Memory is allocated inside a ScratchFrame and released all at once when the frame is destroyed.
+	// When the thread's scratch space is exhausted, allocations fall back to malloc and are freed with their frame.
+	class ScratchAllocator final
+	{
+		struct alignas(16) FallbackBlock
+		{
+			FallbackBlock* next;
+		};
+
+		struct ThreadScratch
+		{
+			~ThreadScratch()
+			{
+				assert(m_framesNum == 0 && "Thread exits inside a scratch frame");
+				FreeFallbackBlocks(nullptr);
+			}
+
+			void FreeFallbackBlocks(FallbackBlock* last)
+			{
+				while (m_fallbackBlocks != last)
+				{
+					FallbackBlock* next = m_fallbackBlocks->next;
+					free(m_fallbackBlocks);
+					m_fallbackBlocks = next;
+				}
+			}
+
+			std::unique_ptr<StackAllocator> m_stack;
+			FallbackBlock* m_fallbackBlocks = nullptr;
+			std::size_t m_framesNum = 0;
+			std::size_t m_capacity = cDefaultScratchCapacity;
+		};
+
+	public:
+		ScratchAllocator() = delete;
+
+		// Sets the scratch capacity of the calling thread. Must be called outside of any frame.
+		static void SetThreadCapacity(const std::size_t capacity)
+		{
+			ThreadScratch& scratch = GetThreadScratch();
+			assert(scratch.m_framesNum == 0 && "Scratch capacity can't change inside a frame");
+
+			scratch.m_capacity = capacity;
+			scratch.m_stack.reset();
+		}
+
+		// Must be called inside a ScratchFrame
+		static void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t))
+		{
+			ThreadScratch& scratch = GetThreadScratch();
+			assert(scratch.m_framesNum > 0 && "Scratch memory must be allocated inside a frame");
+
+			void* dataAddress = scratch.m_stack->TryAllocate(size, alignment);
+			if (dataAddress != nullptr)
+			{
+				return dataAddress;
+			}
+
+			auto* block = static_cast<FallbackBlock*>(malloc(sizeof(FallbackBlock) + alignment + size));
+			block->next = scratch.m_fallbackBlocks;
+			scratch.m_fallbackBlocks = block;
+
+			return PTR_TO_CHAR((PTR_TO_INT(block + 1) + alignment - 1) / alignment * alignment);
+		}
+
+		// Scratch bytes used by the calling thread, not counting fallback blocks
+		static std::size_t GetUsedSize()
+		{
+			const ThreadScratch& scratch = GetThreadScratch();
+			return scratch.m_stack ? scratch.m_stack->GetUsedSize() : 0;
+		}
+
+		static std::size_t GetFallbackBlocksNum()
+		{
+			std::size_t blocksNum = 0;
+			for (FallbackBlock* block = GetThreadScratch().m_fallbackBlocks; block != nullptr; block = block->next)
+			{
+				++blocksNum;
+			}
+
+			return blocksNum;
+		}
+
+	private:
+		friend class ScratchFrame;
+
+		static ThreadScratch& GetThreadScratch()
+		{
+			static thread_local ThreadScratch sThreadScratch;
+			return sThreadScratch;
+		}
+	};
+
+	// Rewinds the thread's scratch memory to where it was at construction
+	class ScratchFrame final
+	{
+	public:
+		ScratchFrame() : m_scratch(ScratchAllocator::GetThreadScratch())
+		{
+			if (!m_scratch.m_stack)
+			{
+				m_scratch.m_stack.reset(new StackAllocator(m_scratch.m_capacity));
+				m_scratch.m_stack->Init();
+			}
+
+			m_marker = m_scratch.m_stack->GetMarker();
+			m_fallbackBlocks = m_scratch.m_fallbackBlocks;
+			++m_scratch.m_framesNum;
+		}
+
+		ScratchFrame(const ScratchFrame&) = delete;
+		ScratchFrame& operator=(const ScratchFrame&) = delete;
+
+		~ScratchFrame()
+		{
+			--m_scratch.m_framesNum;
+			m_scratch.FreeFallbackBlocks(m_fallbackBlocks);
+			m_scratch.m_stack->FreeToMarker(m_marker);
+		}
+
+	private:
+		ScratchAllocator::ThreadScratch& m_scratch;
+		ScratchAllocator::FallbackBlock* m_fallbackBlocks = nullptr;
+		std::size_t m_marker = 0;
+	};
+} // namespace MemAlloc
@@ -0,0 +1,111 @@
+#include "ScratchAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace MemAlloc;
+
+static void RunTest()
+{
+	constexpr std::size_t threadsNum = 4;
+	constexpr std::size_t scratchCapacity = 64 * 1024;
+
+	std::cout << "StartMultiThreadTest: ScratchAllocator\n";
+	std::cout << "Desc: Create " << threadsNum << " threads with " << scratchCapacity << " bytes of scratch memory each. Each thread opens a frame, allocates chunks(MaxChunksNum / " << threadsNum << ") of size = 'rand() % sMaxChunkSize + 1' in nested frames and fills them. Deallocates by closing the frames.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
+
+	std::atomic<bool> failed{false};
+
+	auto threadFunc = [&failed](const std::size_t threadIdx){
+		ScratchAllocator::SetThreadCapacity(scratchCapacity);
+
+		{
+			ScratchFrame outerFrame;
+			auto* outer = static_cast<char*>(ScratchAllocator::Allocate(sMaxChunkSize));
+			memset(outer, static_cast<int>(threadIdx), sMaxChunkSize);
+			const std::size_t outerUsedSize = ScratchAllocator::GetUsedSize();
+
+			for (std::size_t i = 0; i < sMaxChunksNum / threadsNum; ++i)
+			{
+				ScratchFrame innerFrame;
+				std::vector<std::pair<char*, std::size_t>> memPointers;
+
+				// Some frames exceed the scratch capacity and use the malloc fallback
+				for (std::size_t j = 0; j < i % 32; ++j)
+				{
+					const std::size_t size = rand() % sMaxChunkSize + 1;
+					auto* p = static_cast<char*>(ScratchAllocator::Allocate(size));
+					memset(p, static_cast<int>(j), size);
+					memPointers.emplace_back(p, size);
+				}
+
+				for (std::size_t j = 0; j < memPointers.size(); ++j)
+				{
+					if (memPointers[j].first[memPointers[j].second - 1] != static_cast<char>(j))
+					{
+						failed = true;
+					}
+				}
+			}
+
+			if (ScratchAllocator::GetUsedSize() != outerUsedSize || ScratchAllocator::GetFallbackBlocksNum() != 0 ||
+				outer[sMaxChunkSize - 1] != static_cast<char>(threadIdx))
+			{
+				failed = true;
+			}
+		}
+
+		if (ScratchAllocator::GetUsedSize() > 0)
+		{
+			failed = true;
+		}
+	};
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < threadsNum; ++i)
+	{
+		threads.emplace_back(threadFunc, i);
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (failed)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("ScratchAllocator4T", duration);
+}
+
+TEST_REGISTER(ScratchAllocatorTest, RunTest);
+
+static void BM_ScratchAlloc(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		ScratchFrame frame;
+		auto* p = ScratchAllocator::Allocate(1);
+		benchmark::DoNotOptimize(p);
+	}
+
+	state.SetBytesProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ScratchAlloc)->ThreadRange(1, 16);
\ No newline at end of file
@@ -0,0 +1,446 @@
+#pragma once
+
+#include "AllocatorInterface.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <new>
+
+namespace MemAlloc
+{
+	constexpr std::size_t cSegregatedBinsNum = 32;
+	constexpr std::size_t cSegregatedMinBlockShift = 5;
+	constexpr std::size_t cSegregatedMinBlockSize = std::size_t{1} << cSegregatedMinBlockShift;
+
+	// Free list allocator that segregates free blocks by size class. Every power-of-two class has its own bin with
+	// its own lock, so threads allocating different sizes don't contend.
+	// Blocks carry boundary tags (own size and the previous block's size) so that Free() finds both neighbours.
+	// Free() reads the neighbours without locks, then locks the bins of the free neighbours and of the merged block
+	// in address order and checks that the neighbours didn't change meanwhile. Two adjacent blocks freed at the same
+	// time may miss each other; such pairs are merged by Defragment(), which runs when no bin can fit an allocation.
+	template <class TLock = Spinlock>
+	class SegregatedFreeListAllocator final : public AllocatorInterface
+	{
+		static constexpr std::size_t cFreeFlag = 1;
+
+		// Headers are read without locks by the neighbours of a block and changed by the owner of the block
+		// or under the lock of the bin the block is in
+		struct BlockHeader
+		{
+			std::atomic<std::size_t> m_sizeAndFlags;
+			std::atomic<std::size_t> m_prevSize; // 0 for the first block
+		};
+
+		// Links are accessed only under the lock of the bin the block is in
+		struct FreeBlock : BlockHeader
+		{
+			FreeBlock* m_next;
+			FreeBlock* m_prev;
+		};
+
+		struct alignas(64) Bin
+		{
+			TLock m_lock;
+			std::atomic<FreeBlock*> m_head{nullptr}; // Changed under the lock, read without it to skip empty bins
+			std::size_t m_freeSize = 0;
+		};
+
+		static constexpr std::size_t cHeaderSize = sizeof(BlockHeader);
+
+	public:
+		SegregatedFreeListAllocator(const SegregatedFreeListAllocator&) = delete;
+
+		SegregatedFreeListAllocator(const std::size_t totalSize)
+			: AllocatorInterface(totalSize / cHeaderSize * cHeaderSize)
+		{
+			assert(m_totalSize >= cSegregatedMinBlockSize && "Total size is too small");
+		}
+
+		~SegregatedFreeListAllocator() override
+		{
+			free(m_start_ptr);
+			m_start_ptr = nullptr;
+		}
+
+		void Init() override
+		{
+			free(m_start_ptr);
+			m_start_ptr = static_cast<char*>(malloc(m_totalSize));
+
+			Reset();
+		}
+
+		// Must not run concurrently with other methods
+		void Reset()
+		{
+			for (auto& bin : m_bins)
+			{
+				bin.m_head.store(nullptr, std::memory_order_relaxed);
+				bin.m_freeSize = 0;
+			}
+
+			auto* block = new (m_start_ptr) FreeBlock();
+			block->m_sizeAndFlags.store(m_totalSize | cFreeFlag, std::memory_order_relaxed);
+			block->m_prevSize.store(0, std::memory_order_relaxed);
+			PushBlock(GetBinIndex(m_totalSize), block);
+		}
+
+		// Alignment up to 16 bytes is supported
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			assert(alignment <= cHeaderSize && cHeaderSize % alignment == 0 && "Unsupported alignment");
+
+			const std::size_t requiredSize = std::max((cHeaderSize + size + cHeaderSize - 1) / cHeaderSize * cHeaderSize,
+			                                          cSegregatedMinBlockSize);
+
+			bool shouldSplit = false;
+			BlockHeader* block = TakeBlock(requiredSize, shouldSplit);
+			if (block == nullptr)
+			{
+				Defragment();
+			}
+
+			// Blocks unlinked whole by other threads return their rest to the bins once they are split.
+			// There is no memory only if no block was in flight during a whole search.
+			while (block == nullptr)
+			{
+				const std::size_t takesNum = m_wholeTakesNum.load();
+				const std::size_t splitsNum = m_splitsNum.load();
+
+				block = TakeBlock(requiredSize, shouldSplit);
+				if (block != nullptr || (takesNum == splitsNum && takesNum == m_wholeTakesNum.load()))
+				{
+					break;
+				}
+
+				std::this_thread::yield();
+			}
+
+			assert(block != nullptr && "Not enough memory");
+			if (block == nullptr)
+			{
+				return nullptr;
+			}
+
+			if (shouldSplit)
+			{
+				SplitBlock(block, requiredSize);
+				m_splitsNum.fetch_add(1);
+			}
+
+			return PTR_TO_CHAR(block) + cHeaderSize;
+		}
+
+		bool Free(void* ptr) override
+		{
+			if (!Contains(ptr))
+			{
+				return false;
+			}
+
+			auto* block = reinterpret_cast<BlockHeader*>(PTR_TO_CHAR(ptr) - cHeaderSize);
+			assert((block->m_sizeAndFlags.load(std::memory_order_relaxed) & cFreeFlag) == 0 && "Double free");
+
+			FreeBlockAndMerge(block);
+
+			return true;
+		}
+
+		// Merges every pair of adjacent free blocks. Takes the locks of all bins in address order.
+		void Defragment()
+		{
+			for (auto& bin : m_bins)
+			{
+				bin.m_lock.lock();
+			}
+
+			const char* end = m_start_ptr + m_totalSize;
+			auto* block = reinterpret_cast<BlockHeader*>(m_start_ptr);
+
+			while (PTR_TO_CHAR(block) < end)
+			{
+				auto* next = reinterpret_cast<BlockHeader*>(PTR_TO_CHAR(block) + GetSize(block));
+
+				if (IsFree(block) && PTR_TO_CHAR(next) < end && IsFree(next))
+				{
+					const std::size_t mergedSize = GetSize(block) + GetSize(next);
+
+					UnlinkBlock(GetBinIndex(GetSize(block)), static_cast<FreeBlock*>(block));
+					UnlinkBlock(GetBinIndex(GetSize(next)), static_cast<FreeBlock*>(next));
+
+					block->m_sizeAndFlags.store(mergedSize | cFreeFlag, std::memory_order_release);
+					SetPrevSizeOfNext(block);
+					PushBlock(GetBinIndex(mergedSize), static_cast<FreeBlock*>(block));
+				}
+				else
+				{
+					block = next;
+				}
+			}
+
+			for (auto it = m_bins.rbegin(); it != m_bins.rend(); ++it)
+			{
+				it->m_lock.unlock();
+			}
+		}
+
+		// Must not run concurrently with Allocate and Free
+		std::size_t GetUsedSize() const override
+		{
+			std::size_t freeSize = 0;
+			for (const auto& bin : m_bins)
+			{
+				freeSize += bin.m_freeSize;
+			}
+
+			return m_totalSize - freeSize;
+		}
+
+		bool Contains(const void* ptr) const
+		{
+			return ptr >= m_start_ptr && ptr < m_start_ptr + m_totalSize;
+		}
+
+		// Must not run concurrently with other methods
+		bool IsFullyMerged() const
+		{
+			const auto* block = reinterpret_cast<const BlockHeader*>(m_start_ptr);
+			return IsFree(block) && GetSize(block) == m_totalSize;
+		}
+
+	private:
+		static std::size_t GetSize(const BlockHeader* block)
+		{
+			return block->m_sizeAndFlags.load(std::memory_order_acquire) & ~cFreeFlag;
+		}
+
+		static bool IsFree(const BlockHeader* block)
+		{
+			return (block->m_sizeAndFlags.load(std::memory_order_acquire) & cFreeFlag) != 0;
+		}
+
+		// Bin 'i' holds the blocks of [cSegregatedMinBlockSize << i, cSegregatedMinBlockSize << (i + 1)) bytes
+		static std::size_t GetBinIndex(const std::size_t size)
+		{
+			return std::min<std::size_t>(FindLastSet(size) - cSegregatedMinBlockShift, cSegregatedBinsNum - 1);
+		}
+
+		BlockHeader* GetNext(BlockHeader* block) const
+		{
+			char* next = PTR_TO_CHAR(block) + GetSize(block);
+			return next < m_start_ptr + m_totalSize ? reinterpret_cast<BlockHeader*>(next) : nullptr;
+		}
+
+		void SetPrevSizeOfNext(BlockHeader* block)
+		{
+			if (BlockHeader* next = GetNext(block))
+			{
+				next->m_prevSize.store(GetSize(block), std::memory_order_release);
+			}
+		}
+
+		void PushBlock(const std::size_t binIndex, FreeBlock* block)
+		{
+			Bin& bin = m_bins[binIndex];
+			FreeBlock* head = bin.m_head.load(std::memory_order_relaxed);
+
+			block->m_prev = nullptr;
+			block->m_next = head;
+			if (head != nullptr)
+			{
+				head->m_prev = block;
+			}
+
+			bin.m_head.store(block, std::memory_order_relaxed);
+			bin.m_freeSize += GetSize(block);
+		}
+
+		void UnlinkBlock(const std::size_t binIndex, FreeBlock* block)
+		{
+			Bin& bin = m_bins[binIndex];
+
+			if (block->m_prev != nullptr)
+			{
+				block->m_prev->m_next = block->m_next;
+			}
+			else
+			{
+				bin.m_head.store(block->m_next, std::memory_order_relaxed);
+			}
+
+			if (block->m_next != nullptr)
+			{
+				block->m_next->m_prev = block->m_prev;
+			}
+
+			bin.m_freeSize -= GetSize(block);
+		}
+
+		// Finds a block of at least 'size' bytes: the bin of the size is searched first fit, bigger bins just give
+		// their first block. If the rest of the block stays in the same bin, the allocated block is cut from its end
+		// under the bin lock. Otherwise the block is unlinked whole and marked allocated, and the caller splits it.
+		BlockHeader* TakeBlock(const std::size_t size, bool& shouldSplit)
+		{
+			for (std::size_t binIndex = GetBinIndex(size); binIndex < cSegregatedBinsNum; ++binIndex)
+			{
+				Bin& bin = m_bins[binIndex];
+				if (bin.m_head.load(std::memory_order_relaxed) == nullptr)
+				{
+					continue;
+				}
+
+				LockGuard<TLock> guard(bin.m_lock);
+
+				for (FreeBlock* block = bin.m_head.load(std::memory_order_relaxed); block != nullptr; block = block->m_next)
+				{
+					const std::size_t blockSize = GetSize(block);
+					if (blockSize < size)
+					{
+						continue;
+					}
+
+					const std::size_t restSize = blockSize - size;
+					if (restSize >= cSegregatedMinBlockSize && GetBinIndex(restSize) == binIndex)
+					{
+						// The tail is published before the free block shrinks
+						auto* tail = new (PTR_TO_CHAR(block) + restSize) BlockHeader();
+						tail->m_sizeAndFlags.store(size, std::memory_order_release);
+						tail->m_prevSize.store(restSize, std::memory_order_release);
+						SetPrevSizeOfNext(tail);
+
+						block->m_sizeAndFlags.store(restSize | cFreeFlag, std::memory_order_release);
+						bin.m_freeSize -= size;
+
+						shouldSplit = false;
+						return tail;
+					}
+
+					UnlinkBlock(binIndex, block);
+					block->m_sizeAndFlags.store(blockSize, std::memory_order_release);
+
+					shouldSplit = restSize >= cSegregatedMinBlockSize;
+					if (shouldSplit)
+					{
+						m_wholeTakesNum.fetch_add(1);
+					}
+
+					return block;
+				}
+			}
+
+			return nullptr;
+		}
+
+		// The block is allocated and owned by the caller. The rest beyond 'size' is freed as a separate block.
+		void SplitBlock(BlockHeader* block, const std::size_t size)
+		{
+			const std::size_t restSize = GetSize(block) - size;
+
+			// The rest is published as an allocated block before the block shrinks
+			auto* rest = new (PTR_TO_CHAR(block) + size) BlockHeader();
+			rest->m_sizeAndFlags.store(restSize, std::memory_order_release);
+			rest->m_prevSize.store(size, std::memory_order_release);
+			SetPrevSizeOfNext(rest);
+
+			block->m_sizeAndFlags.store(size, std::memory_order_release);
+
+			FreeBlockAndMerge(rest);
+		}
+
+		// The block is allocated and owned by the caller
+		void FreeBlockAndMerge(BlockHeader* block)
+		{
+			const std::size_t size = GetSize(block);
+
+			while (true)
+			{
+				// Read the neighbours without locks
+				BlockHeader* prev = nullptr;
+				std::size_t prevSize = 0;
+				std::size_t prevHeader = 0;
+				if (PTR_TO_CHAR(block) != m_start_ptr)
+				{
+					prevSize = block->m_prevSize.load(std::memory_order_acquire);
+					prev = reinterpret_cast<BlockHeader*>(PTR_TO_CHAR(block) - prevSize);
+					prevHeader = prev->m_sizeAndFlags.load(std::memory_order_acquire);
+				}
+
+				BlockHeader* next = GetNext(block);
+				const std::size_t nextHeader = next != nullptr ? next->m_sizeAndFlags.load(std::memory_order_acquire) : 0;
+
+				const bool isPrevFree = prev != nullptr && prevHeader == (prevSize | cFreeFlag);
+				const bool isNextFree = next != nullptr && (nextHeader & cFreeFlag) != 0;
+				const std::size_t nextSize = nextHeader & ~cFreeFlag;
+				const std::size_t mergedSize = size + (isPrevFree ? prevSize : 0) + (isNextFree ? nextSize : 0);
+
+				// Lock the bins in address order
+				Bin* bins[3];
+				std::size_t binsNum = 0;
+				bins[binsNum++] = &m_bins[GetBinIndex(mergedSize)];
+				if (isPrevFree)
+				{
+					bins[binsNum++] = &m_bins[GetBinIndex(prevSize)];
+				}
+				if (isNextFree)
+				{
+					bins[binsNum++] = &m_bins[GetBinIndex(nextSize)];
+				}
+
+				// Insertion sort of up to three bins, then drop the duplicates
+				for (std::size_t i = 1; i < binsNum; ++i)
+				{
+					for (std::size_t j = i; j > 0 && bins[j] < bins[j - 1]; --j)
+					{
+						std::swap(bins[j], bins[j - 1]);
+					}
+				}
+				binsNum = static_cast<std::size_t>(std::unique(bins, bins + binsNum) - bins);
+
+				for (std::size_t i = 0; i < binsNum; ++i)
+				{
+					bins[i]->m_lock.lock();
+				}
+
+				// A free neighbour can't change while its bin is locked, an allocated one could have been freed meanwhile
+				const bool isValid = (prev == nullptr || (block->m_prevSize.load(std::memory_order_acquire) == prevSize &&
+				                                          prev->m_sizeAndFlags.load(std::memory_order_acquire) == prevHeader)) &&
+				                     (next == nullptr || next->m_sizeAndFlags.load(std::memory_order_acquire) == nextHeader);
+
+				if (isValid)
+				{
+					BlockHeader* mergedBlock = block;
+
+					if (isPrevFree)
+					{
+						UnlinkBlock(GetBinIndex(prevSize), static_cast<FreeBlock*>(prev));
+						mergedBlock = prev;
+					}
+					if (isNextFree)
+					{
+						UnlinkBlock(GetBinIndex(nextSize), static_cast<FreeBlock*>(next));
+					}
+
+					mergedBlock->m_sizeAndFlags.store(mergedSize | cFreeFlag, std::memory_order_release);
+					SetPrevSizeOfNext(mergedBlock);
+					PushBlock(GetBinIndex(mergedSize), static_cast<FreeBlock*>(mergedBlock));
+				}
+
+				for (std::size_t i = binsNum; i > 0; --i)
+				{
+					bins[i - 1]->m_lock.unlock();
+				}
+
+				if (isValid)
+				{
+					return;
+				}
+			}
+		}
+
+	private:
+		char* m_start_ptr = nullptr;
+		std::array<Bin, cSegregatedBinsNum> m_bins;
+		std::atomic<std::size_t> m_wholeTakesNum{0}; // Blocks unlinked whole to be split by the allocating thread
+		std::atomic<std::size_t> m_splitsNum{0}; // Blocks of m_wholeTakesNum whose rest is back in the bins
+	};
+} // namespace MemAlloc
@@ -0,0 +1,142 @@
+#include "FreeListAllocator.h"
+#include "SegregatedFreeListAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+using namespace MemAlloc;
+
+static void RunTest()
+{
+	constexpr std::size_t threadsNum = 4;
+
+	std::cout << "StartMultiThreadTest: SegregatedFreeListAllocator\n";
+	std::cout << "Desc: Create " << threadsNum << " threads. Each thread allocates chunks(MaxChunksNum / " << threadsNum << ") of size = 'rand() % sMaxChunkSize + 1', marks them and deallocates in random order.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
+
+	SegregatedFreeListAllocator<> allocator(2 * sMaxChunksNum * sMaxChunkSize);
+	allocator.Init();
+
+	std::atomic<bool> corrupted{false};
+
+	auto threadFunc = [&allocator, &corrupted](const std::size_t threadIdx){
+		std::vector<void*> memPointers;
+		std::vector<std::size_t> sizes;
+		memPointers.reserve(sMaxChunksNum / threadsNum);
+		sizes.reserve(sMaxChunksNum / threadsNum);
+
+		for (std::size_t i = 0; i < sMaxChunksNum / threadsNum; ++i)
+		{
+			const auto size = rand() % sMaxChunkSize + 1;
+			auto* p = static_cast<char*>(allocator.Allocate(size));
+			p[0] = static_cast<char>(threadIdx);
+			p[size - 1] = static_cast<char>(threadIdx);
+			memPointers.emplace_back(p);
+			sizes.emplace_back(size);
+		}
+
+		const std::size_t memPointersNum = memPointers.size();
+		for (int i = static_cast<int>(memPointersNum) - 1; i >= 0; --i)
+		{
+			const auto idx = (i != 0 ? rand() % i : 0);
+			const auto* p = static_cast<char*>(memPointers[idx]);
+			if (p[0] != static_cast<char>(threadIdx) || p[sizes[idx] - 1] != static_cast<char>(threadIdx))
+			{
+				corrupted = true;
+			}
+			allocator.Free(memPointers[idx]);
+			memPointers.erase(memPointers.begin() + idx);
+			sizes.erase(sizes.begin() + idx);
+		}
+	};
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < threadsNum; ++i)
+	{
+		threads.emplace_back(threadFunc, i);
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (allocator.GetUsedSize() > 0 || corrupted)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	// Blocks freed at the same time by different threads may be left unmerged until a defragmentation
+	allocator.Defragment();
+	if (allocator.IsFullyMerged())
+	{
+		std::cout << green << "FullMerge Test Passed!\n" << white;
+	}
+	else
+	{
+		std::cout << red << "FullMerge Test Failed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("SegregatedFreeL4T ", duration);
+}
+
+TEST_REGISTER(SegregatedFreeListAllocatorTest, RunTest);
+
+// Each thread allocates its own size class and keeps a few blocks alive, so the single lock of FreeListAllocator
+// is shared by all threads while SegregatedFreeListAllocator threads mostly take the lock of their own bin
+constexpr std::size_t cMixedSizesLiveBlocksNum = 8;
+
+template <class TAllocator>
+static TAllocator* sMixedSizesAllocator = nullptr;
+
+template <class TAllocator>
+static void BM_FreeListMixedSizes(benchmark::State& state)
+{
+	if (state.thread_index() == 0)
+	{
+		sMixedSizesAllocator<TAllocator> = new TAllocator(sMaxChunksNum * sMaxChunkSize);
+		sMixedSizesAllocator<TAllocator>->Init();
+	}
+
+	const std::size_t size = std::size_t{48} << (state.thread_index() % 8);
+	void* blocks[cMixedSizesLiveBlocksNum] = {};
+	std::size_t blockIdx = 0;
+
+	for (auto _ : state)
+	{
+		if (blocks[blockIdx] != nullptr)
+		{
+			sMixedSizesAllocator<TAllocator>->Free(blocks[blockIdx]);
+		}
+
+		blocks[blockIdx] = sMixedSizesAllocator<TAllocator>->Allocate(size);
+		benchmark::DoNotOptimize(blocks[blockIdx]);
+
+		blockIdx = (blockIdx + 1) % cMixedSizesLiveBlocksNum;
+	}
+
+	// Blocks still alive go away with the allocator, which the first thread may already be deleting
+	state.SetBytesProcessed(state.iterations() * size);
+
+	if (state.thread_index() == 0)
+	{
+		delete sMixedSizesAllocator<TAllocator>;
+		sMixedSizesAllocator<TAllocator> = nullptr;
+	}
+}
+
+BENCHMARK(BM_FreeListMixedSizes<FreeListAllocator<Spinlock>>)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_FreeListMixedSizes<SegregatedFreeListAllocator<Spinlock>>)->ThreadRange(1, 16)->UseRealTime();
\ No newline at end of file
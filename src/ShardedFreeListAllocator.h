@@ -0,0 +1,155 @@
+#pragma once
+
+#include "FreeListAllocator.h"
+#include <functional>
+#include <memory>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace MemAlloc
+{
+	// Splits the heap into several FreeListAllocator arenas, each behind its own lock.
+	// A thread allocates from the arena of its CPU (or thread id) and moves on to the neighbouring arenas
+	// when the home one is locked or full. A pointer is freed to the arena whose range contains it.
+	template <class TLock = Spinlock>
+	class ShardedFreeListAllocator final : public AllocatorInterface
+	{
+		struct Shard
+		{
+			Shard(const std::size_t totalSize) : m_arena(totalSize)
+			{
+			}
+
+			TLock m_lock;
+			FreeListAllocator<> m_arena;
+		};
+
+	public:
+		ShardedFreeListAllocator(ShardedFreeListAllocator& shardedFreeListAllocator) = delete;
+
+		ShardedFreeListAllocator(const std::size_t totalSize,
+		                         const std::size_t shardsNum = std::thread::hardware_concurrency())
+			: AllocatorInterface(totalSize)
+		{
+			const std::size_t shardsCount = shardsNum > 0 ? shardsNum : 1;
+			const std::size_t shardSize = totalSize / shardsCount;
+
+			m_shards.reserve(shardsCount);
+			for (std::size_t i = 0; i < shardsCount; ++i)
+			{
+				m_shards.emplace_back(new Shard(shardSize));
+			}
+		}
+
+		void Init() override
+		{
+			for (auto& shard : m_shards)
+			{
+				shard->m_arena.Init();
+			}
+		}
+
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			const std::size_t homeIndex = GetHomeShardIndex();
+
+			// Skip busy arenas first
+			for (std::size_t i = 0; i < m_shards.size(); ++i)
+			{
+				Shard& shard = GetShard(homeIndex + i);
+				if (shard.m_lock.try_lock())
+				{
+					void* resultPtr = shard.m_arena.TryAllocate(size, alignment);
+					shard.m_lock.unlock();
+
+					if (resultPtr != nullptr)
+					{
+						return resultPtr;
+					}
+				}
+			}
+
+			// Every arena was either busy or full, wait for each one in turn
+			for (std::size_t i = 0; i < m_shards.size(); ++i)
+			{
+				Shard& shard = GetShard(homeIndex + i);
+				LockGuard<TLock> guard(shard.m_lock);
+
+				void* resultPtr = shard.m_arena.TryAllocate(size, alignment);
+				if (resultPtr != nullptr)
+				{
+					return resultPtr;
+				}
+			}
+
+			assert(false && "Not enough memory");
+			return nullptr;
+		}
+
+		bool Free(void* ptr) override
+		{
+			for (auto& shard : m_shards)
+			{
+				if (shard->m_arena.Contains(ptr))
+				{
+					LockGuard<TLock> guard(shard->m_lock);
+					return shard->m_arena.Free(ptr);
+				}
+			}
+
+			return false;
+		}
+
+		std::size_t GetUsedSize() const override
+		{
+			std::size_t usedSize = 0;
+			for (const auto& shard : m_shards)
+			{
+				usedSize += shard->m_arena.GetUsedSize();
+			}
+
+			return usedSize;
+		}
+
+		bool IsFullyMerged() const
+		{
+			for (const auto& shard : m_shards)
+			{
+				if (!shard->m_arena.IsFullyMerged())
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		std::size_t GetShardsNum() const
+		{
+			return m_shards.size();
+		}
+
+	private:
+		Shard& GetShard(const std::size_t index)
+		{
+			return *m_shards[index % m_shards.size()];
+		}
+
+		std::size_t GetHomeShardIndex() const
+		{
+#ifdef __linux__
+			const int cpu = sched_getcpu();
+			if (cpu >= 0)
+			{
+				return static_cast<std::size_t>(cpu);
+			}
+#endif
+			return std::hash<std::thread::id>()(std::this_thread::get_id());
+		}
+
+	private:
+		std::vector<std::unique_ptr<Shard>> m_shards;
+	};
+} // namespace MemAlloc
@@ -0,0 +1,118 @@
+#include "ShardedFreeListAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+using namespace MemAlloc;
+
+static void RunTest()
+{
+	constexpr std::size_t threadsNum = 4;
+	constexpr std::size_t shardsNum = 4;
+
+	std::cout << "StartMultiThreadTest: ShardedFreeListAllocator\n";
+	std::cout << "Desc: Creates " << shardsNum << " free list arenas. Create " << threadsNum << " threads. Each thread allocates chunks(MaxChunksNum / " << threadsNum << ") of size = 'rand() % sMaxChunkSize + 1', marks them and deallocates in random order.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
+
+	ShardedFreeListAllocator<> allocator(2 * sMaxChunksNum * sMaxChunkSize, shardsNum);
+	allocator.Init();
+
+	std::atomic<bool> corrupted{false};
+
+	auto threadFunc = [&allocator, &corrupted](const std::size_t threadIdx){
+		std::vector<void*> memPointers;
+		memPointers.reserve(sMaxChunksNum / threadsNum);
+
+		for (std::size_t i = 0; i < sMaxChunksNum / threadsNum; ++i)
+		{
+			const auto size = rand() % sMaxChunkSize + 1;
+			auto* p = static_cast<char*>(allocator.Allocate(size));
+			p[0] = static_cast<char>(threadIdx);
+			p[size - 1] = static_cast<char>(threadIdx);
+			memPointers.emplace_back(p);
+		}
+
+		const std::size_t memPointersNum = memPointers.size();
+		for (int i = static_cast<int>(memPointersNum) - 1; i >= 0; --i)
+		{
+			const auto idx = (i != 0 ? rand() % i : 0);
+			if (*static_cast<char*>(memPointers[idx]) != static_cast<char>(threadIdx))
+			{
+				corrupted = true;
+			}
+			allocator.Free(memPointers[idx]);
+			memPointers.erase(memPointers.begin() + idx);
+		}
+	};
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < threadsNum; ++i)
+	{
+		threads.emplace_back(threadFunc, i);
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (allocator.GetUsedSize() > 0 || corrupted)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	if (allocator.IsFullyMerged())
+	{
+		std::cout << green << "FullMerge Test Passed!\n" << white;
+	}
+	else
+	{
+		std::cout << red << "FullMerge Test Failed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("ShardedFreeList4T ", duration);
+}
+
+TEST_REGISTER(ShardedFreeListAllocatorTest, RunTest);
+
+// Compare with BM_FreeListAllocThreads, the same loop over a single locked arena
+static ShardedFreeListAllocator<>* sShardedFreeList = nullptr;
+
+static void BM_ShardedFreeListAlloc(benchmark::State& state)
+{
+	if (state.thread_index() == 0)
+	{
+		sShardedFreeList = new ShardedFreeListAllocator<>(sMaxChunksNum * sMaxChunkSize);
+		sShardedFreeList->Init();
+	}
+
+	for (auto _ : state)
+	{
+		auto* p = sShardedFreeList->Allocate(1);
+		benchmark::DoNotOptimize(p);
+		sShardedFreeList->Free(p);
+	}
+
+	state.SetBytesProcessed(state.iterations());
+
+	if (state.thread_index() == 0)
+	{
+		delete sShardedFreeList;
+		sShardedFreeList = nullptr;
+	}
+}
+
+BENCHMARK(BM_ShardedFreeListAlloc)->ThreadRange(1, 16)->UseRealTime();
\ No newline at end of file
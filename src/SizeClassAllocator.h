@@ -0,0 +1,211 @@
+#pragma once
+
+#include "AllocatorInterface.h"
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace MemAlloc
+{
+	// Sizes up to cSizeClassLinearMax take a class every cSizeClassGranularity bytes, above it every power of two is
+	// split into cSizeClassSubClassesNum classes, so a chunk wastes at most a quarter of its size
+	constexpr std::size_t cSizeClassGranularityLog2 = 4;
+	constexpr std::size_t cSizeClassGranularity = std::size_t{1} << cSizeClassGranularityLog2;
+	constexpr std::size_t cSizeClassSubClassesLog2 = 2;
+	constexpr std::size_t cSizeClassSubClassesNum = std::size_t{1} << cSizeClassSubClassesLog2;
+	constexpr std::size_t cSizeClassLinearMaxLog2 = cSizeClassGranularityLog2 + cSizeClassSubClassesLog2;
+	constexpr std::size_t cSizeClassLinearMax = std::size_t{1} << cSizeClassLinearMaxLog2;
+	constexpr std::size_t cSizeClassesMaxNum = 64; // Up to 2 MiB
+
+	// Index of the smallest size class that fits the size, with a find-last-set instead of a search over the classes.
+	// Treating the linear sizes as the first power of two above them folds both ranges into the same formula.
+	inline std::size_t GetSizeClass(const std::size_t size)
+	{
+		const std::size_t lastByte = size != 0 ? size - 1 : 0;
+		const std::size_t log2 = FindLastSet(lastByte | cSizeClassLinearMax);
+
+		return ((log2 - cSizeClassLinearMaxLog2) << cSizeClassSubClassesLog2) + (lastByte >> (log2 - cSizeClassSubClassesLog2));
+	}
+
+	// Chunk size of a size class, the inverse of GetSizeClass
+	inline std::size_t GetSizeClassSize(const std::size_t sizeClass)
+	{
+		if (sizeClass < cSizeClassSubClassesNum)
+		{
+			return (sizeClass + 1) << cSizeClassGranularityLog2;
+		}
+
+		const std::size_t log2 = cSizeClassLinearMaxLog2 + ((sizeClass - cSizeClassSubClassesNum) >> cSizeClassSubClassesLog2);
+		const std::size_t subClass = (sizeClass - cSizeClassSubClassesNum) & (cSizeClassSubClassesNum - 1);
+
+		return (cSizeClassSubClassesNum + subClass + 1) << (log2 - cSizeClassSubClassesLog2);
+	}
+
+	// Pools of chunks of every size class up to maxSize. The size class of an allocation is computed from its size
+	// and every class owns a region of the arena of the same power of two size, so Free finds the owner with a
+	// shift of the offset in the arena. Neither depends on the number of classes, unlike searching the pools.
+	// Like PoolAllocator in PoolFreeListMode::Intrusive, each class links its free chunks through their first bytes
+	// and hands out the chunks that were never allocated by bumping an index, so Reset doesn't touch the arena.
+	// Each class has its own lock, TLock is the locking policy, NoLock by default (see AllocatorInterface.h)
+	template <class TLock = NoLock>
+	class SizeClassAllocator final : public AllocatorInterface
+	{
+		// Aligned to a cache line so that threads allocating different sizes don't share one
+		struct alignas(64) SizeClass
+		{
+			char* m_freeListHead = nullptr;
+			char* m_regionStart = nullptr;
+			std::size_t m_chunkSize = 0;
+			std::size_t m_chunksNum = 0;
+			std::size_t m_untouchedChunksIdx = 0;
+			std::size_t m_used = 0;
+			TLock m_lock;
+		};
+
+	public:
+		SizeClassAllocator(const SizeClassAllocator&) = delete;
+
+		// regionSize is the memory of each class and must be a power of two that fits a chunk of maxSize
+		SizeClassAllocator(const std::size_t regionSize, const std::size_t maxSize)
+			: AllocatorInterface(regionSize * (GetSizeClass(maxSize) + 1)), m_sizeClassesNum(GetSizeClass(maxSize) + 1),
+			  m_maxSize(GetSizeClassSize(m_sizeClassesNum - 1)), m_regionSizeLog2(FindLastSet(regionSize))
+		{
+			assert((regionSize & (regionSize - 1)) == 0 && "Region size must be a power of two");
+			assert(m_sizeClassesNum <= cSizeClassesMaxNum && "Max size is too big");
+			assert(m_maxSize <= regionSize && "Region size must fit a chunk of max size");
+		}
+
+		~SizeClassAllocator() override
+		{
+			free(m_start_ptr);
+		}
+
+		void Init() override
+		{
+			free(m_start_ptr);
+			m_start_ptr = static_cast<char*>(malloc(m_totalSize));
+
+			for (std::size_t i = 0; i < m_sizeClassesNum; ++i)
+			{
+				SizeClass& sizeClass = m_sizeClasses[i];
+				sizeClass.m_regionStart = m_start_ptr + (i << m_regionSizeLog2);
+				sizeClass.m_chunkSize = GetSizeClassSize(i);
+				sizeClass.m_chunksNum = (std::size_t{1} << m_regionSizeLog2) / sizeClass.m_chunkSize;
+			}
+
+			Reset();
+		}
+
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			void* dataAddress = TryAllocate(size, alignment);
+			assert(dataAddress != nullptr && "The size class is full");
+
+			return dataAddress;
+		}
+
+		// Same as Allocate but returns nullptr when the class of the size is full
+		void* TryAllocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t))
+		{
+			assert(size <= m_maxSize && "Allocation size must be <= to max size");
+			assert(cSizeClassGranularity % alignment == 0 && "Unsupported alignment");
+
+			SizeClass& sizeClass = m_sizeClasses[GetSizeClass(size)];
+
+			LockGuard<TLock> guard(sizeClass.m_lock);
+
+			char* chunk = sizeClass.m_freeListHead;
+			if (chunk != nullptr)
+			{
+				sizeClass.m_freeListHead = *reinterpret_cast<char**>(chunk);
+			}
+			else if (sizeClass.m_untouchedChunksIdx < sizeClass.m_chunksNum)
+			{
+				chunk = sizeClass.m_regionStart + sizeClass.m_untouchedChunksIdx++ * sizeClass.m_chunkSize;
+			}
+			else
+			{
+				return nullptr;
+			}
+
+			sizeClass.m_used += sizeClass.m_chunkSize;
+
+			return chunk;
+		}
+
+		bool Free(void* ptr) override
+		{
+			if (!Contains(ptr))
+			{
+				return false;
+			}
+
+			SizeClass& sizeClass = m_sizeClasses[static_cast<std::size_t>(PTR_TO_CHAR(ptr) - m_start_ptr) >> m_regionSizeLog2];
+			assert(static_cast<std::size_t>(PTR_TO_CHAR(ptr) - sizeClass.m_regionStart) % sizeClass.m_chunkSize == 0 &&
+			       "Pointer must be the start of a chunk");
+
+			LockGuard<TLock> guard(sizeClass.m_lock);
+
+			*static_cast<char**>(ptr) = sizeClass.m_freeListHead;
+			sizeClass.m_freeListHead = PTR_TO_CHAR(ptr);
+			sizeClass.m_used -= sizeClass.m_chunkSize;
+
+			return true;
+		}
+
+		void Reset()
+		{
+			for (std::size_t i = 0; i < m_sizeClassesNum; ++i)
+			{
+				SizeClass& sizeClass = m_sizeClasses[i];
+
+				LockGuard<TLock> guard(sizeClass.m_lock);
+
+				sizeClass.m_freeListHead = nullptr;
+				sizeClass.m_untouchedChunksIdx = 0;
+				sizeClass.m_used = 0;
+			}
+		}
+
+		// Sum of the classes, each one counts the chunk size of its allocations
+		std::size_t GetUsedSize() const override
+		{
+			std::size_t used = 0;
+			for (std::size_t i = 0; i < m_sizeClassesNum; ++i)
+			{
+				used += m_sizeClasses[i].m_used;
+			}
+
+			return used;
+		}
+
+		std::size_t GetSizeClassesNum() const
+		{
+			return m_sizeClassesNum;
+		}
+
+		std::size_t GetMaxSize() const
+		{
+			return m_maxSize;
+		}
+
+		bool Contains(const void* ptr) const
+		{
+			return ptr >= m_start_ptr && ptr < m_start_ptr + m_totalSize;
+		}
+
+		// Must be called after Init and before any chunk is allocated
+		void FirstTouch()
+		{
+			TouchPages(m_start_ptr, m_totalSize);
+		}
+
+	private:
+		char* m_start_ptr = nullptr;
+		std::size_t m_sizeClassesNum = 0;
+		std::size_t m_maxSize = 0;
+		std::size_t m_regionSizeLog2 = 0;
+		std::array<SizeClass, cSizeClassesMaxNum> m_sizeClasses;
+	};
+} // namespace MemAlloc
@@ -0,0 +1,87 @@
+#include "SizeClassAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+using namespace MemAlloc;
+
+static void RunTest()
+{
+	constexpr std::size_t regionSize = 8 * 1024 * 1024;
+
+	std::cout << "StartTest: SizeClassAllocator\n";
+	std::cout << "Desc: Checks that every size maps to the smallest class that fits it. Allocates chunks(MaxChunksNum) of size = 'rand() % sMaxChunkSize + 1', marks them and deallocates in random order.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
+
+	SizeClassAllocator<> allocator(regionSize, sMaxChunkSize);
+	allocator.Init();
+
+	bool isPassed = allocator.GetMaxSize() >= sMaxChunkSize;
+
+	for (std::size_t size = 1; size <= allocator.GetMaxSize(); ++size)
+	{
+		const std::size_t sizeClass = GetSizeClass(size);
+		isPassed &= GetSizeClassSize(sizeClass) >= size;
+		isPassed &= sizeClass == 0 || GetSizeClassSize(sizeClass - 1) < size;
+	}
+
+	std::vector<std::size_t*> memPointers;
+	memPointers.reserve(sMaxChunksNum);
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	for (std::size_t i = 0; i < sMaxChunksNum; ++i)
+	{
+		const std::size_t size = rand() % sMaxChunkSize + 1;
+		auto* p = static_cast<std::size_t*>(allocator.Allocate(size));
+		// The first and the last words of the chunk, an overlapping chunk would overwrite one of them
+		p[0] = size;
+		p[(size - 1) / sizeof(std::size_t)] = size;
+		memPointers.emplace_back(p);
+	}
+
+	for (int i = sMaxChunksNum - 1; i >= 0; --i)
+	{
+		const auto idx = (i != 0 ? rand() % i : 0);
+		std::size_t* p = memPointers[idx];
+		isPassed &= p[(p[0] - 1) / sizeof(std::size_t)] == p[0];
+		isPassed &= allocator.Free(p);
+		memPointers.erase(memPointers.begin() + idx);
+	}
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (!isPassed || allocator.GetUsedSize() > 0)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("SizeClassAllocator", duration);
+}
+
+TEST_REGISTER(SizeClassAllocatorTest, RunTest);
+
+static void BM_SizeClassAlloc(benchmark::State& state)
+{
+	SizeClassAllocator<> allocator(64 * 1024, sMaxChunkSize);
+	allocator.Init();
+
+	for (auto _ : state)
+	{
+		auto* p = allocator.Allocate(1);
+		allocator.Free(p);
+	}
+
+	state.SetBytesProcessed(state.iterations());
+}
+
+BENCHMARK(BM_SizeClassAlloc);
\ No newline at end of file
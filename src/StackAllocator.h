@@ -32,11 +32,19 @@ namespace MemAlloc
 		}
 
 		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			void* dataAddress = TryAllocate(size, alignment);
+			assert(dataAddress != nullptr && "The pool allocator is full");
+
+			return dataAddress;
+		}
+
+		// Same as Allocate but returns nullptr when the stack is full
+		void* TryAllocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t))
 		{
 			const std::size_t padding = alignment - size % alignment;
 			const std::size_t requiredSize = m_offset + padding + size;
 
-			assert(requiredSize <= m_totalSize && "The pool allocator is full");
 			if (requiredSize > m_totalSize)
 			{
 				return nullptr;
@@ -66,6 +74,18 @@ namespace MemAlloc
 			m_used = 0;
 		}
 
+		std::size_t GetMarker() const
+		{
+			return m_offset;
+		}
+
+		// Frees everything allocated after the marker was taken
+		void FreeToMarker(const std::size_t marker)
+		{
+			assert(marker <= m_offset && "Marker is above the top of the stack");
+			m_used = m_offset = marker;
+		}
+
 	protected:
 		char* m_start_ptr = nullptr;
 		std::size_t m_offset = 0;
@@ -0,0 +1,128 @@
+#pragma once
+#include <cassert>
+
+#include "AllocatorInterface.h"
+
+namespace MemAlloc
+{
+	constexpr std::size_t cDefaultLeaseSize = 64 * 1024; // 64KiB
+
+	// Linear allocator shared between threads through thread-local allocation buffers (TLAB).
+	// A thread leases a block of the arena with a single atomic fetch_add and then bump-allocates inside it
+	// without any synchronization. Reset() invalidates every lease at once by switching the arena epoch.
+	// Each thread keeps one lease, so a thread that alternates between two allocators drops the rest of its lease.
+	class TLABLinearAllocator final : public AllocatorInterface
+	{
+		struct Lease
+		{
+			std::size_t m_epoch = 0;
+			char* m_current = nullptr;
+			char* m_end = nullptr;
+		};
+
+	public:
+		TLABLinearAllocator(TLABLinearAllocator& tlabLinearAllocator) = delete;
+
+		TLABLinearAllocator(const std::size_t totalSize, const std::size_t leaseSize = cDefaultLeaseSize)
+			: AllocatorInterface(totalSize), m_leaseSize(leaseSize)
+		{
+		}
+
+		~TLABLinearAllocator() override
+		{
+			free(m_start_ptr);
+			m_start_ptr = nullptr;
+		}
+
+		void Init() override
+		{
+			free(m_start_ptr);
+			m_start_ptr = static_cast<char*>(malloc(m_totalSize));
+
+			Reset();
+		}
+
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			Lease& lease = GetLease();
+
+			if (lease.m_epoch == m_epoch.load(std::memory_order_relaxed))
+			{
+				char* dataAddress = AlignUp(lease.m_current, alignment);
+				if (dataAddress + size <= lease.m_end)
+				{
+					lease.m_current = dataAddress + size;
+					return dataAddress;
+				}
+			}
+
+			return AllocateFromNewLease(lease, size, alignment);
+		}
+
+		bool Free(void* ptr) override
+		{
+			assert(false && "Use Reset() method");
+			return false;
+		}
+
+		// Must not run concurrently with Allocate
+		void Reset()
+		{
+			m_offset.store(0, std::memory_order_relaxed);
+			m_epoch.store(GetNextEpoch(), std::memory_order_release);
+		}
+
+		// Leased bytes, including the unused tails of the leases
+		std::size_t GetUsedSize() const override
+		{
+			const std::size_t offset = m_offset.load(std::memory_order_relaxed);
+			return offset < m_totalSize ? offset : m_totalSize;
+		}
+
+	private:
+		void* AllocateFromNewLease(Lease& lease, const std::size_t size, const std::size_t alignment)
+		{
+			const std::size_t requiredSize = size + alignment;
+			const std::size_t leaseSize = requiredSize > m_leaseSize ? requiredSize : m_leaseSize;
+
+			const std::size_t offset = m_offset.fetch_add(leaseSize, std::memory_order_relaxed);
+
+			assert(offset + leaseSize <= m_totalSize && "The linear allocator is full");
+			if (offset + leaseSize > m_totalSize)
+			{
+				return nullptr;
+			}
+
+			lease.m_epoch = m_epoch.load(std::memory_order_relaxed);
+			lease.m_end = m_start_ptr + offset + leaseSize;
+
+			char* dataAddress = AlignUp(m_start_ptr + offset, alignment);
+			lease.m_current = dataAddress + size;
+
+			return dataAddress;
+		}
+
+		static char* AlignUp(char* ptr, const std::size_t alignment)
+		{
+			return PTR_TO_CHAR((PTR_TO_INT(ptr) + alignment - 1) & ~(alignment - 1));
+		}
+
+		static std::size_t GetNextEpoch()
+		{
+			static std::atomic<std::size_t> sNextEpoch{1};
+			return sNextEpoch.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		static Lease& GetLease()
+		{
+			static thread_local Lease sLease;
+			return sLease;
+		}
+
+	private:
+		char* m_start_ptr = nullptr;
+		const std::size_t m_leaseSize;
+		std::atomic<std::size_t> m_epoch{0};
+		alignas(64) std::atomic<std::size_t> m_offset{0};
+	};
+}
@@ -0,0 +1,125 @@
+#include "TLABLinearAllocator.h"
+#include "Test.h"
+#include "benchmark/benchmark.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace MemAlloc;
+
+static void RunTest()
+{
+	constexpr std::size_t threadsNum = 4;
+
+	std::cout << "StartMultiThreadTest: TLABLinearAllocator\n";
+	std::cout << "Desc: Create " << threadsNum << " threads. Each thread allocates chunks(MaxChunksNum / " << threadsNum << ") of size = 'rand() % sMaxChunkSize + 1' from a shared linear allocator and fills them. Deallocates by resetting.\n";
+	std::cout << "MaxChunksNum " << sMaxChunksNum << "\n";
+	std::cout << "MaxChunkSize " << sMaxChunkSize << "\n";
+
+	TLABLinearAllocator allocator(2 * sMaxChunksNum * sMaxChunkSize);
+	allocator.Init();
+
+	std::atomic<bool> corrupted{false};
+
+	auto threadFunc = [&allocator, &corrupted](const std::size_t threadIdx){
+		std::vector<std::pair<char*, std::size_t>> memPointers;
+		memPointers.reserve(sMaxChunksNum / threadsNum);
+
+		for (std::size_t i = 0; i < sMaxChunksNum / threadsNum; ++i)
+		{
+			const std::size_t size = rand() % sMaxChunkSize + 1;
+			auto* p = static_cast<char*>(allocator.Allocate(size));
+			memset(p, static_cast<int>(threadIdx), size);
+			memPointers.emplace_back(p, size);
+		}
+
+		for (const auto& memPointer : memPointers)
+		{
+			for (std::size_t i = 0; i < memPointer.second; ++i)
+			{
+				if (memPointer.first[i] != static_cast<char>(threadIdx))
+				{
+					corrupted = true;
+					return;
+				}
+			}
+		}
+	};
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::thread> threads;
+	for (std::size_t i = 0; i < threadsNum; ++i)
+	{
+		threads.emplace_back(threadFunc, i);
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	allocator.Reset();
+
+	const auto finish = std::chrono::high_resolution_clock::now();
+	const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+
+	std::cout << "Time = " << duration << "ns\n";
+
+	if (allocator.GetUsedSize() > 0 || corrupted)
+	{
+		std::cout << red << "Test Failed!\n" << white;
+	}
+	else
+	{
+		std::cout << green << "Test Passed!\n" << white;
+	}
+
+	// The lease of this thread must not survive Reset()
+	void* first = allocator.Allocate(1);
+	allocator.Reset();
+	void* second = allocator.Allocate(1);
+	if (first == second)
+	{
+		std::cout << green << "Reset Test Passed!\n" << white;
+	}
+	else
+	{
+		std::cout << red << "Reset Test Failed!\n" << white;
+	}
+
+	Test::GetTestResults().emplace("TLABLinearAlloc4T ", duration);
+}
+
+TEST_REGISTER(TLABLinearAllocatorTest, RunTest);
+
+// Fixed iterations keep every thread within the arena, compare with BM_LinerAlloc
+static constexpr std::size_t cTLABIterations = 1 << 18;
+static TLABLinearAllocator* sTLABAllocator = nullptr;
+
+static void BM_TLABLinearAlloc(benchmark::State& state)
+{
+	if (state.thread_index() == 0)
+	{
+		sTLABAllocator = new TLABLinearAllocator(state.threads() * (cTLABIterations * 2 * sizeof(std::size_t) + cDefaultLeaseSize));
+		sTLABAllocator->Init();
+	}
+
+	for (auto _ : state)
+	{
+		auto* p = sTLABAllocator->Allocate(1);
+		benchmark::DoNotOptimize(p);
+	}
+
+	state.SetBytesProcessed(state.iterations());
+
+	if (state.thread_index() == 0)
+	{
+		delete sTLABAllocator;
+		sTLABAllocator = nullptr;
+	}
+}
+
+BENCHMARK(BM_TLABLinearAlloc)->Iterations(cTLABIterations)->ThreadRange(1, 16);
\ No newline at end of file
@@ -0,0 +1,323 @@
+#pragma once
+
+#include "AllocatorInterface.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace MemAlloc
+{
+	constexpr std::size_t cTlsfSlIndexCountLog2 = 5;
+	constexpr std::size_t cTlsfSlIndexCount = std::size_t{1} << cTlsfSlIndexCountLog2;
+	constexpr std::size_t cTlsfAlignSizeLog2 = 4;
+	constexpr std::size_t cTlsfAlignSize = std::size_t{1} << cTlsfAlignSizeLog2;
+	constexpr std::size_t cTlsfFlIndexShift = cTlsfSlIndexCountLog2 + cTlsfAlignSizeLog2;
+	constexpr std::size_t cTlsfFlIndexMax = 40; // Blocks up to 1 TiB
+	constexpr std::size_t cTlsfFlIndexCount = cTlsfFlIndexMax - cTlsfFlIndexShift + 1;
+	constexpr std::size_t cTlsfSmallBlockSize = std::size_t{1} << cTlsfFlIndexShift;
+	constexpr std::size_t cTlsfMinBlockSize = 4 * sizeof(std::size_t); // The header and the free list links
+
+	// Two-level segregated fit allocator (M. Masmano et al.). Free blocks are kept in lists indexed by the first
+	// level, the power of two of the size, and the second level, one of cTlsfSlIndexCount linear subdivisions of it.
+	// A bitmap per level tells which lists are not empty, so Allocate finds a fitting list with two find-first-set
+	// instructions and Free merges the block with its physical neighbours through the block headers.
+	// Both are O(1) regardless of the number of free blocks, which bounds the worst-case latency.
+	// TLock is the locking policy of the instance, NoLock by default (see AllocatorInterface.h)
+	template <class TLock = NoLock>
+	class TLSFAllocator final : public AllocatorInterface
+	{
+		static constexpr std::size_t cFreeFlag = 1;
+
+		struct BlockHeader
+		{
+			BlockHeader* m_prevPhysBlock; // nullptr for the first block
+			std::size_t m_sizeAndFlags; // The size includes the header
+			// The links are valid only while the block is free, the user data starts here otherwise
+			BlockHeader* m_nextFree;
+			BlockHeader* m_prevFree;
+		};
+
+		static constexpr std::size_t cHeaderSize = 2 * sizeof(std::size_t);
+
+		static_assert(cHeaderSize % cTlsfAlignSize == 0, "The user data must stay aligned");
+		static_assert(sizeof(BlockHeader) <= cTlsfMinBlockSize, "A free block must fit its header");
+		static_assert(cTlsfFlIndexCount <= 32 && cTlsfSlIndexCount <= 32, "Bitmaps are 32 bits wide");
+
+	public:
+		TLSFAllocator(const TLSFAllocator&) = delete;
+
+		TLSFAllocator(const std::size_t totalSize)
+			: AllocatorInterface(totalSize / cTlsfAlignSize * cTlsfAlignSize)
+		{
+			assert(m_totalSize >= cTlsfMinBlockSize && "Total size is too small");
+			assert(m_totalSize < (std::size_t{1} << cTlsfFlIndexMax) && "Total size is too big for the first level");
+		}
+
+		~TLSFAllocator() override
+		{
+			free(m_start_ptr);
+			m_start_ptr = nullptr;
+		}
+
+		void Init() override
+		{
+			free(m_start_ptr);
+			m_start_ptr = static_cast<char*>(malloc(m_totalSize));
+
+			Reset();
+		}
+
+		// Alignment up to cTlsfAlignSize is supported
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			void* resultPtr = TryAllocate(size, alignment);
+			assert(resultPtr != nullptr && "Not enough memory");
+
+			return resultPtr;
+		}
+
+		// Same as Allocate but returns nullptr when there is no block to fit the size
+		void* TryAllocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t))
+		{
+			assert(alignment <= cTlsfAlignSize && cTlsfAlignSize % alignment == 0 && "Unsupported alignment");
+
+			const std::size_t requiredSize = std::max((cHeaderSize + size + cTlsfAlignSize - 1) / cTlsfAlignSize * cTlsfAlignSize,
+			                                          cTlsfMinBlockSize);
+
+			LockGuard<TLock> guard(m_lock);
+
+			BlockHeader* block = FindFreeBlock(requiredSize);
+			if (block == nullptr)
+			{
+				return nullptr;
+			}
+
+			RemoveFreeBlock(block);
+
+			const std::size_t restSize = GetSize(block) - requiredSize;
+			if (restSize >= cTlsfMinBlockSize)
+			{
+				auto* rest = reinterpret_cast<BlockHeader*>(PTR_TO_CHAR(block) + requiredSize);
+				rest->m_prevPhysBlock = block;
+				rest->m_sizeAndFlags = restSize | cFreeFlag;
+				SetPrevPhysOfNext(rest);
+				InsertFreeBlock(rest);
+
+				block->m_sizeAndFlags = requiredSize;
+			}
+			else
+			{
+				block->m_sizeAndFlags = GetSize(block);
+			}
+
+			m_used += GetSize(block);
+
+			return PTR_TO_CHAR(block) + cHeaderSize;
+		}
+
+		bool Free(void* ptr) override
+		{
+			if (!Contains(ptr))
+			{
+				return false;
+			}
+
+			auto* block = reinterpret_cast<BlockHeader*>(PTR_TO_CHAR(ptr) - cHeaderSize);
+
+			LockGuard<TLock> guard(m_lock);
+
+			assert(!IsFree(block) && "Double free");
+
+			m_used -= GetSize(block);
+
+			BlockHeader* prev = block->m_prevPhysBlock;
+			if (prev != nullptr && IsFree(prev))
+			{
+				RemoveFreeBlock(prev);
+				prev->m_sizeAndFlags = GetSize(prev) + GetSize(block);
+				block = prev;
+			}
+
+			BlockHeader* next = GetNextPhysBlock(block);
+			if (next != nullptr && IsFree(next))
+			{
+				RemoveFreeBlock(next);
+				block->m_sizeAndFlags = GetSize(block) + GetSize(next);
+			}
+
+			block->m_sizeAndFlags |= cFreeFlag;
+			SetPrevPhysOfNext(block);
+			InsertFreeBlock(block);
+
+			return true;
+		}
+
+		void Reset()
+		{
+			LockGuard<TLock> guard(m_lock);
+
+			m_flBitmap = 0;
+			std::fill(std::begin(m_slBitmaps), std::end(m_slBitmaps), 0);
+			for (auto& freeLists : m_freeLists)
+			{
+				std::fill(std::begin(freeLists), std::end(freeLists), nullptr);
+			}
+
+			auto* block = reinterpret_cast<BlockHeader*>(m_start_ptr);
+			block->m_prevPhysBlock = nullptr;
+			block->m_sizeAndFlags = m_totalSize | cFreeFlag;
+			InsertFreeBlock(block);
+
+			m_used = 0;
+		}
+
+		bool Contains(const void* ptr) const
+		{
+			return ptr >= m_start_ptr && ptr < m_start_ptr + m_totalSize;
+		}
+
+		bool IsFullyMerged() const
+		{
+			const auto* block = reinterpret_cast<const BlockHeader*>(m_start_ptr);
+			return IsFree(block) && GetSize(block) == m_totalSize;
+		}
+
+	private:
+		static std::size_t GetSize(const BlockHeader* block)
+		{
+			return block->m_sizeAndFlags & ~cFreeFlag;
+		}
+
+		static bool IsFree(const BlockHeader* block)
+		{
+			return (block->m_sizeAndFlags & cFreeFlag) != 0;
+		}
+
+		BlockHeader* GetNextPhysBlock(BlockHeader* block) const
+		{
+			char* next = PTR_TO_CHAR(block) + GetSize(block);
+			return next < m_start_ptr + m_totalSize ? reinterpret_cast<BlockHeader*>(next) : nullptr;
+		}
+
+		void SetPrevPhysOfNext(BlockHeader* block)
+		{
+			if (BlockHeader* next = GetNextPhysBlock(block))
+			{
+				next->m_prevPhysBlock = block;
+			}
+		}
+
+		// The lists of small blocks are cTlsfAlignSize apart, bigger sizes are split into cTlsfSlIndexCount lists
+		// per power of two
+		static void MappingInsert(const std::size_t size, std::size_t& fl, std::size_t& sl)
+		{
+			if (size < cTlsfSmallBlockSize)
+			{
+				fl = 0;
+				sl = size >> cTlsfAlignSizeLog2;
+			}
+			else
+			{
+				const std::size_t highestBit = FindLastSet(size);
+				sl = (size >> (highestBit - cTlsfSlIndexCountLog2)) ^ cTlsfSlIndexCount;
+				fl = highestBit - cTlsfFlIndexShift + 1;
+			}
+		}
+
+		// Rounds the size up to the next list, so that any block of the found list fits
+		static void MappingSearch(const std::size_t size, std::size_t& fl, std::size_t& sl)
+		{
+			std::size_t roundedSize = size;
+			if (size >= cTlsfSmallBlockSize)
+			{
+				roundedSize += (std::size_t{1} << (FindLastSet(size) - cTlsfSlIndexCountLog2)) - 1;
+			}
+
+			MappingInsert(roundedSize, fl, sl);
+		}
+
+		BlockHeader* FindFreeBlock(const std::size_t size) const
+		{
+			std::size_t fl = 0;
+			std::size_t sl = 0;
+			MappingSearch(size, fl, sl);
+
+			if (fl >= cTlsfFlIndexCount)
+			{
+				return nullptr;
+			}
+
+			std::uint32_t slMap = m_slBitmaps[fl] & (~std::uint32_t{0} << sl);
+			if (slMap == 0)
+			{
+				// Any list of a bigger first level fits
+				const std::uint32_t flMap = fl + 1 < 32 ? m_flBitmap & (~std::uint32_t{0} << (fl + 1)) : 0;
+				if (flMap == 0)
+				{
+					return nullptr;
+				}
+
+				fl = FindFirstSet(flMap);
+				slMap = m_slBitmaps[fl];
+			}
+
+			return m_freeLists[fl][FindFirstSet(slMap)];
+		}
+
+		void InsertFreeBlock(BlockHeader* block)
+		{
+			std::size_t fl = 0;
+			std::size_t sl = 0;
+			MappingInsert(GetSize(block), fl, sl);
+
+			BlockHeader* head = m_freeLists[fl][sl];
+			block->m_prevFree = nullptr;
+			block->m_nextFree = head;
+			if (head != nullptr)
+			{
+				head->m_prevFree = block;
+			}
+			m_freeLists[fl][sl] = block;
+
+			m_flBitmap |= std::uint32_t{1} << fl;
+			m_slBitmaps[fl] |= std::uint32_t{1} << sl;
+		}
+
+		void RemoveFreeBlock(BlockHeader* block)
+		{
+			std::size_t fl = 0;
+			std::size_t sl = 0;
+			MappingInsert(GetSize(block), fl, sl);
+
+			if (block->m_prevFree != nullptr)
+			{
+				block->m_prevFree->m_nextFree = block->m_nextFree;
+			}
+			else
+			{
+				m_freeLists[fl][sl] = block->m_nextFree;
+			}
+
+			if (block->m_nextFree != nullptr)
+			{
+				block->m_nextFree->m_prevFree = block->m_prevFree;
+			}
+
+			if (m_freeLists[fl][sl] == nullptr)
+			{
+				m_slBitmaps[fl] &= ~(std::uint32_t{1} << sl);
+				if (m_slBitmaps[fl] == 0)
+				{
+					m_flBitmap &= ~(std::uint32_t{1} << fl);
+				}
+			}
+		}
+
+	private:
+		char* m_start_ptr = nullptr;
+		TLock m_lock;
+		std::uint32_t m_flBitmap = 0;
+		std::uint32_t m_slBitmaps[cTlsfFlIndexCount] = {};
+		BlockHeader* m_freeLists[cTlsfFlIndexCount][cTlsfSlIndexCount] = {};
+	};
+} // namespace MemAlloc
@@ -0,0 +1,548 @@
+#pragma once
+
+#include "PoolAllocator.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+// The rseq area is found from the thread pointer, which older compilers can't read through a builtin
+#if defined(__linux__) && defined(__has_include) && defined(__has_builtin)
+#if __has_include(<sys/rseq.h>) && __has_builtin(__builtin_thread_pointer)
+#include <sys/rseq.h>
+#define MEMALLOC_HAS_RSEQ
+#endif
+#endif
+
+namespace MemAlloc
+{
+	constexpr std::size_t cThreadCacheCapacity = 64;
+	constexpr std::size_t cThreadCacheBatchSize = cThreadCacheCapacity / 2;
+
+	enum class PoolCacheMode
+	{
+		PerThread,
+		PerCpu // Falls back to PerThread for threads without rseq
+	};
+
+	// Current CPU read from the rseq area that glibc registers for every thread, or -1 without rseq
+	inline int GetRseqCpuId()
+	{
+#ifdef MEMALLOC_HAS_RSEQ
+		if (__rseq_size == 0)
+		{
+			return -1;
+		}
+
+		const auto* rseqArea = reinterpret_cast<const struct rseq*>(static_cast<const char*>(__builtin_thread_pointer()) + __rseq_offset);
+		return static_cast<std::int32_t>(__atomic_load_n(&rseqArea->cpu_id, __ATOMIC_RELAXED));
+#else
+		return -1;
+#endif
+	}
+
+	// Puts a small bounded deque of chunks per thread in front of a shared PoolAllocator.
+	// The shared pool is locked only to refill an empty cache or to flush a full one, a batch of chunks at a time.
+	// Cached chunks go back to the shared pool when their thread exits.
+	// When the shared pool is empty too, a thread steals half of the chunks from each of the other threads' caches,
+	// so chunks hoarded by threads that free more than they allocate are not lost to the rest.
+	// In PoolCacheMode::PerCpu the caches belong to CPUs instead of threads, so idle threads don't hold any chunks.
+	// The current CPU comes from rseq, and the spinlock of a CPU cache is contended only when a thread is preempted
+	// or migrated inside Allocate/Free.
+	class ThreadCachePoolAllocator final : public AllocatorInterface
+	{
+		struct alignas(64) CpuCache
+		{
+			Spinlock m_lock;
+			std::size_t m_count = 0;
+			void* m_chunks[cThreadCacheCapacity];
+		};
+
+		// Bounded Chase-Lev deque: the owner thread pushes and pops at the bottom, other threads steal from the top
+		struct alignas(64) ThreadCache
+		{
+			// Owner only. Returns false when the cache is full.
+			bool Push(void* chunk)
+			{
+				const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+				const std::int64_t top = m_top.load(std::memory_order_acquire);
+
+				if (bottom - top >= static_cast<std::int64_t>(cThreadCacheCapacity))
+				{
+					return false;
+				}
+
+				m_chunks[bottom % cThreadCacheCapacity].store(chunk, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+
+				return true;
+			}
+
+			// Owner only
+			void* Pop()
+			{
+				const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+				m_bottom.store(bottom, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				std::int64_t top = m_top.load(std::memory_order_relaxed);
+
+				void* chunk = nullptr;
+				if (top <= bottom)
+				{
+					chunk = m_chunks[bottom % cThreadCacheCapacity].load(std::memory_order_relaxed);
+
+					// The last chunk may be taken by a thief at the same time
+					if (top == bottom)
+					{
+						if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+						{
+							chunk = nullptr;
+						}
+						m_bottom.store(bottom + 1, std::memory_order_relaxed);
+					}
+				}
+				else
+				{
+					m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				}
+
+				return chunk;
+			}
+
+			// Any thread. Returns nullptr when the cache is empty or another thread won the race.
+			void* Steal()
+			{
+				std::int64_t top = m_top.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				const std::int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+				if (top >= bottom)
+				{
+					return nullptr;
+				}
+
+				void* chunk = m_chunks[top % cThreadCacheCapacity].load(std::memory_order_relaxed);
+				if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					return nullptr;
+				}
+
+				return chunk;
+			}
+
+			// Approximate when other threads use the cache
+			std::size_t GetSize() const
+			{
+				const std::int64_t size = m_bottom.load(std::memory_order_relaxed) - m_top.load(std::memory_order_relaxed);
+				return size > 0 ? static_cast<std::size_t>(size) : 0;
+			}
+
+			ThreadCachePoolAllocator* m_owner = nullptr; // Guarded by GetRegistryMutex()
+			std::size_t m_ownerId = 0;
+			std::atomic<std::int64_t> m_top{0};
+			alignas(64) std::atomic<std::int64_t> m_bottom{0};
+			std::atomic<void*> m_chunks[cThreadCacheCapacity];
+		};
+
+		// Owns every cache of the current thread and flushes them when the thread exits
+		struct ThreadCaches
+		{
+			~ThreadCaches()
+			{
+				std::lock_guard<std::mutex> lock(GetRegistryMutex());
+
+				for (auto* cache : m_caches)
+				{
+					if (cache->m_owner != nullptr)
+					{
+						cache->m_owner->Flush(cache, cThreadCacheCapacity);
+						cache->m_owner->Unregister(cache);
+					}
+
+					delete cache;
+				}
+
+				GetLastCache() = nullptr;
+			}
+
+			std::vector<ThreadCache*> m_caches;
+		};
+
+	public:
+		ThreadCachePoolAllocator() = delete;
+		ThreadCachePoolAllocator(const ThreadCachePoolAllocator&) = delete;
+
+		ThreadCachePoolAllocator(const std::size_t chunksNum, const std::size_t chunkSize, const bool workStealing = true,
+		                         const PoolCacheMode cacheMode = PoolCacheMode::PerThread)
+			: AllocatorInterface(chunksNum * chunkSize), m_pool(chunksNum, chunkSize), m_id(GetNextId()), m_workStealing(workStealing)
+		{
+			if (cacheMode == PoolCacheMode::PerCpu)
+			{
+				const std::size_t cpusNum = std::thread::hardware_concurrency();
+				m_cpuCachesNum = cpusNum > 0 ? cpusNum : 1;
+				m_cpuCaches.reset(new CpuCache[m_cpuCachesNum]);
+			}
+		}
+
+		~ThreadCachePoolAllocator() override
+		{
+			// Caches of the threads that are still alive are released by those threads
+			std::lock_guard<std::mutex> lock(GetRegistryMutex());
+
+			for (auto* cache : m_caches)
+			{
+				cache->m_owner = nullptr;
+			}
+		}
+
+		// Must be called before any thread starts allocating
+		void Init() override
+		{
+			m_pool.Init();
+		}
+
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			void* dataAddress = TryAllocate(size, alignment);
+			assert(dataAddress != nullptr && "The pool allocator is full");
+
+			return dataAddress;
+		}
+
+		// Same as Allocate but returns nullptr when neither the shared pool nor other threads' caches have a chunk
+		void* TryAllocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t))
+		{
+			assert(size <= m_pool.GetChunkSize() && "Allocation size must be <= to chunk size");
+
+			const int cpu = m_cpuCaches ? GetRseqCpuId() : -1;
+
+			void* dataAddress = cpu >= 0 ? AllocateFromCpuCache(GetCpuCache(cpu)) : AllocateFromThreadCache();
+
+			assert(PTR_TO_INT(dataAddress) % alignment == 0 && "Data address must be aligment");
+
+			return dataAddress;
+		}
+
+		bool Free(void* ptr) override
+		{
+			if (!m_pool.Contains(ptr))
+			{
+				return false;
+			}
+
+			const int cpu = m_cpuCaches ? GetRseqCpuId() : -1;
+			if (cpu >= 0)
+			{
+				FreeToCpuCache(GetCpuCache(cpu), ptr);
+				return true;
+			}
+
+			ThreadCache* cache = GetThreadCache();
+
+			if (!cache->Push(ptr))
+			{
+				Flush(cache, cThreadCacheBatchSize);
+				cache->Push(ptr);
+			}
+
+			return true;
+		}
+
+		// Returns the cached chunks of the calling thread to the shared pool
+		void FlushThreadCache()
+		{
+			Flush(GetThreadCache(), cThreadCacheCapacity);
+		}
+
+		// Returns the cached chunks of every CPU to the shared pool
+		void FlushCpuCaches()
+		{
+			for (std::size_t i = 0; i < m_cpuCachesNum; ++i)
+			{
+				CpuCache& cache = m_cpuCaches[i];
+				SpinlockGuard guard(cache.m_lock);
+
+				m_pool.FreeBatch(cache.m_chunks, cache.m_count);
+				cache.m_count = 0;
+			}
+		}
+
+		// Chunks parked in thread and CPU caches are counted as used
+		std::size_t GetUsedSize() const override
+		{
+			return m_pool.GetUsedSize();
+		}
+
+		std::size_t GetChunkSize() const
+		{
+			return m_pool.GetChunkSize();
+		}
+
+	private:
+		void* AllocateFromThreadCache()
+		{
+			ThreadCache* cache = GetThreadCache();
+
+			void* dataAddress = cache->Pop();
+			if (dataAddress == nullptr)
+			{
+				Refill(cache);
+				dataAddress = cache->Pop();
+			}
+
+			if (dataAddress == nullptr && m_workStealing)
+			{
+				dataAddress = StealFromOtherCaches(cache);
+			}
+
+			return dataAddress;
+		}
+
+		CpuCache& GetCpuCache(const int cpu)
+		{
+			return m_cpuCaches[static_cast<std::size_t>(cpu) % m_cpuCachesNum];
+		}
+
+		void* AllocateFromCpuCache(CpuCache& cache)
+		{
+			{
+				SpinlockGuard guard(cache.m_lock);
+
+				if (cache.m_count == 0)
+				{
+					cache.m_count = m_pool.AllocateBatch(cThreadCacheBatchSize, cache.m_chunks);
+				}
+
+				if (cache.m_count > 0)
+				{
+					return cache.m_chunks[--cache.m_count];
+				}
+			}
+
+			return m_workStealing ? StealFromOtherCpuCaches(cache) : nullptr;
+		}
+
+		void FreeToCpuCache(CpuCache& cache, void* ptr)
+		{
+			SpinlockGuard guard(cache.m_lock);
+
+			if (cache.m_count == cThreadCacheCapacity)
+			{
+				cache.m_count -= cThreadCacheBatchSize;
+				m_pool.FreeBatch(cache.m_chunks + cache.m_count, cThreadCacheBatchSize);
+			}
+
+			cache.m_chunks[cache.m_count++] = ptr;
+		}
+
+		// Takes half of the chunks of the first non-empty CPU cache. One chunk is returned, the rest go to 'home'.
+		void* StealFromOtherCpuCaches(CpuCache& home)
+		{
+			void* chunks[cThreadCacheCapacity];
+			std::size_t stolenNum = 0;
+
+			for (std::size_t i = 0; i < m_cpuCachesNum && stolenNum == 0; ++i)
+			{
+				CpuCache& victim = m_cpuCaches[i];
+				if (&victim == &home)
+				{
+					continue;
+				}
+
+				SpinlockGuard guard(victim.m_lock);
+
+				stolenNum = (victim.m_count + 1) / 2;
+				victim.m_count -= stolenNum;
+				std::copy(victim.m_chunks + victim.m_count, victim.m_chunks + victim.m_count + stolenNum, chunks);
+			}
+
+			if (stolenNum == 0)
+			{
+				return nullptr;
+			}
+
+			SpinlockGuard guard(home.m_lock);
+
+			const std::size_t keptNum = std::min(stolenNum - 1, cThreadCacheCapacity - home.m_count);
+			std::copy(chunks + 1, chunks + 1 + keptNum, home.m_chunks + home.m_count);
+			home.m_count += keptNum;
+			m_pool.FreeBatch(chunks + 1 + keptNum, stolenNum - 1 - keptNum);
+
+			return chunks[0];
+		}
+
+		ThreadCache* GetThreadCache()
+		{
+			ThreadCache* cache = GetLastCache();
+			if (cache != nullptr && cache->m_ownerId == m_id)
+			{
+				return cache;
+			}
+
+			return FindOrCreateThreadCache();
+		}
+
+		ThreadCache* FindOrCreateThreadCache()
+		{
+			auto& caches = GetThreadCaches().m_caches;
+
+			for (auto* cache : caches)
+			{
+				if (cache->m_ownerId == m_id)
+				{
+					GetLastCache() = cache;
+					return cache;
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(GetRegistryMutex());
+
+			// Drop the caches of destroyed allocators
+			for (auto it = caches.begin(); it != caches.end();)
+			{
+				if ((*it)->m_owner == nullptr)
+				{
+					delete *it;
+					it = caches.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+
+			auto* cache = new ThreadCache();
+			cache->m_owner = this;
+			cache->m_ownerId = m_id;
+
+			caches.push_back(cache);
+			m_caches.push_back(cache);
+
+			GetLastCache() = cache;
+			return cache;
+		}
+
+		// The cache must be empty
+		void Refill(ThreadCache* cache)
+		{
+			void* chunks[cThreadCacheBatchSize];
+			const std::size_t count = m_pool.AllocateBatch(cThreadCacheBatchSize, chunks);
+
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				cache->Push(chunks[i]);
+			}
+		}
+
+		// Moves up to 'count' chunks from the bottom of the cache to the shared pool
+		void Flush(ThreadCache* cache, const std::size_t count)
+		{
+			void* chunks[cThreadCacheCapacity];
+			std::size_t flushedNum = 0;
+
+			while (flushedNum < count)
+			{
+				void* chunk = cache->Pop();
+				if (chunk == nullptr)
+				{
+					break;
+				}
+
+				chunks[flushedNum++] = chunk;
+			}
+
+			m_pool.FreeBatch(chunks, flushedNum);
+		}
+
+		// Takes half of the chunks of every other cache. One chunk is returned, the rest go to the thief's own cache.
+		// Stops once the thief's cache is full, a chunk that is stolen must have a place to go.
+		void* StealFromOtherCaches(ThreadCache* cache)
+		{
+			void* dataAddress = nullptr;
+
+			// Keeps the victims alive while their threads exit
+			std::lock_guard<std::mutex> lock(GetRegistryMutex());
+
+			for (auto* victim : m_caches)
+			{
+				if (victim == cache)
+				{
+					continue;
+				}
+
+				const std::size_t stealNum = (victim->GetSize() + 1) / 2;
+				for (std::size_t i = 0; i < stealNum; ++i)
+				{
+					// Only the owner pushes to its cache, other thieves can only make room
+					if (dataAddress != nullptr && cache->GetSize() >= cThreadCacheCapacity)
+					{
+						return dataAddress;
+					}
+
+					void* chunk = victim->Steal();
+					if (chunk == nullptr)
+					{
+						break;
+					}
+
+					if (dataAddress == nullptr)
+					{
+						dataAddress = chunk;
+					}
+					else if (!cache->Push(chunk))
+					{
+						m_pool.Free(chunk);
+						return dataAddress;
+					}
+				}
+			}
+
+			return dataAddress;
+		}
+
+		// Called under GetRegistryMutex()
+		void Unregister(ThreadCache* cache)
+		{
+			for (auto it = m_caches.begin(); it != m_caches.end(); ++it)
+			{
+				if (*it == cache)
+				{
+					m_caches.erase(it);
+					return;
+				}
+			}
+		}
+
+		static std::size_t GetNextId()
+		{
+			static std::atomic<std::size_t> sNextId{1};
+			return sNextId.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		static std::mutex& GetRegistryMutex()
+		{
+			static std::mutex sRegistryMutex;
+			return sRegistryMutex;
+		}
+
+		static ThreadCaches& GetThreadCaches()
+		{
+			static thread_local ThreadCaches sThreadCaches;
+			return sThreadCaches;
+		}
+
+		static ThreadCache*& GetLastCache()
+		{
+			static thread_local ThreadCache* sLastCache = nullptr;
+			return sLastCache;
+		}
+
+	private:
+		PoolAllocator<Spinlock> m_pool;
+		const std::size_t m_id;
+		const bool m_workStealing;
+		std::size_t m_cpuCachesNum = 0;
+		std::unique_ptr<CpuCache[]> m_cpuCaches;
+		std::vector<ThreadCache*> m_caches; // Guarded by GetRegistryMutex()
+	};
+} // namespace MemAlloc
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "AllocatorInterface.h"
+#include <cassert>
+#include <iterator>
+#include <map>
+#include <set>
+#include <utility>
+
+namespace MemAlloc
+{
+	// Free list allocator that indexes its free blocks with two balanced trees: one ordered by size for the best fit
+	// and one ordered by offset for merging with the neighbours. Allocate and Free are O(log n) in the number of
+	// free blocks, instead of the linear scans of FreeListAllocator, and the number of free blocks is not bounded.
+	// A block whose offset doesn't change relative to its neighbours goes back to the offset tree with a hint,
+	// so the insertion doesn't search the tree again.
+	// TLock is the locking policy of the instance, NoLock by default (see AllocatorInterface.h)
+	template <class TLock = NoLock>
+	class TreeFreeListAllocator final : public AllocatorInterface
+	{
+		struct alignas(sizeof(std::size_t)) AllocationHeader
+		{
+			std::size_t blockSize;
+		};
+
+		static constexpr std::size_t cAllocationHeaderSize = sizeof(AllocationHeader);
+
+		using BlocksBySize = std::set<std::pair<std::size_t, std::size_t>>; // (size, offset)
+		using BlocksByOffset = std::map<std::size_t, std::size_t>; // offset -> size
+
+	public:
+		TreeFreeListAllocator(const TreeFreeListAllocator&) = delete;
+
+		TreeFreeListAllocator(const std::size_t totalSize)
+			: AllocatorInterface(totalSize)
+		{
+		}
+
+		~TreeFreeListAllocator() override
+		{
+			free(m_start_ptr);
+			m_start_ptr = nullptr;
+		}
+
+		void Init() override
+		{
+			free(m_start_ptr);
+			m_start_ptr = static_cast<char*>(malloc(m_totalSize));
+
+			Reset();
+		}
+
+		void* Allocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t)) override
+		{
+			void* resultPtr = TryAllocate(size, alignment);
+			assert(resultPtr != nullptr && "Not enough memory");
+
+			return resultPtr;
+		}
+
+		// Same as Allocate but returns nullptr when there is no block to fit the size
+		void* TryAllocate(const std::size_t size, const std::size_t alignment = sizeof(std::size_t))
+		{
+			assert(alignment % sizeof(std::size_t) == 0 && "Alignment must be a multiple of the header size");
+
+			const std::size_t requiredSize = (cAllocationHeaderSize + size + alignment - 1) / alignment * alignment;
+
+			LockGuard<TLock> guard(m_lock);
+
+			// Best fit: the smallest block that is big enough, the lowest offset among equal sizes
+			auto bySizeIt = m_blocksBySize.lower_bound({requiredSize, 0});
+			if (bySizeIt == m_blocksBySize.end())
+			{
+				return nullptr;
+			}
+
+			const std::size_t blockSize = bySizeIt->first;
+			const std::size_t offset = bySizeIt->second;
+			const std::size_t restSize = blockSize - requiredSize;
+
+			m_blocksBySize.erase(bySizeIt);
+			auto byOffsetIt = m_blocksByOffset.erase(m_blocksByOffset.find(offset));
+
+			if (restSize > 0)
+			{
+				// The rest stays between the same neighbours, so the offset tree takes it back at the same position
+				m_blocksByOffset.emplace_hint(byOffsetIt, offset + requiredSize, restSize);
+				m_blocksBySize.emplace(restSize, offset + requiredSize);
+			}
+
+			auto* allocationHeader = reinterpret_cast<AllocationHeader*>(m_start_ptr + offset);
+			allocationHeader->blockSize = requiredSize;
+
+			void* resultPtr = PTR_TO_CHAR(allocationHeader) + cAllocationHeaderSize;
+			assert(PTR_TO_INT(resultPtr) % alignment == 0 && "Data address must be aligned");
+
+			m_used += requiredSize;
+
+			return resultPtr;
+		}
+
+		bool Free(void* ptr) override
+		{
+			if (!Contains(ptr))
+			{
+				return false;
+			}
+
+			auto* allocationHeader = reinterpret_cast<AllocationHeader*>(PTR_TO_CHAR(ptr) - cAllocationHeaderSize);
+			const std::size_t offset = static_cast<std::size_t>(PTR_TO_CHAR(allocationHeader) - m_start_ptr);
+			std::size_t blockSize = allocationHeader->blockSize;
+
+			LockGuard<TLock> guard(m_lock);
+
+			m_used -= blockSize;
+
+			auto nextIt = m_blocksByOffset.lower_bound(offset);
+			const bool hasPrev = nextIt != m_blocksByOffset.begin() && std::prev(nextIt)->first + std::prev(nextIt)->second == offset;
+			const bool hasNext = nextIt != m_blocksByOffset.end() && nextIt->first == offset + blockSize;
+
+			if (hasPrev)
+			{
+				auto prevIt = std::prev(nextIt);
+				m_blocksBySize.erase({prevIt->second, prevIt->first});
+
+				blockSize += prevIt->second;
+				if (hasNext)
+				{
+					m_blocksBySize.erase({nextIt->second, nextIt->first});
+					blockSize += nextIt->second;
+					m_blocksByOffset.erase(nextIt);
+				}
+
+				prevIt->second = blockSize;
+				m_blocksBySize.emplace(blockSize, prevIt->first);
+			}
+			else if (hasNext)
+			{
+				// The merged block starts at the freed one, so the offset key of the next block moves down
+				m_blocksBySize.erase({nextIt->second, nextIt->first});
+				blockSize += nextIt->second;
+
+				auto afterNextIt = m_blocksByOffset.erase(nextIt);
+				m_blocksByOffset.emplace_hint(afterNextIt, offset, blockSize);
+				m_blocksBySize.emplace(blockSize, offset);
+			}
+			else
+			{
+				m_blocksByOffset.emplace_hint(nextIt, offset, blockSize);
+				m_blocksBySize.emplace(blockSize, offset);
+			}
+
+			return true;
+		}
+
+		void Reset()
+		{
+			LockGuard<TLock> guard(m_lock);
+
+			m_blocksBySize.clear();
+			m_blocksByOffset.clear();
+
+			m_blocksBySize.emplace(m_totalSize, 0);
+			m_blocksByOffset.emplace(0, m_totalSize);
+
+			m_used = 0;
+		}
+
+		bool Contains(const void* ptr) const
+		{
+			return ptr >= m_start_ptr && ptr < m_start_ptr + m_totalSize;
+		}
+
+		std::size_t GetFreeMemBlocksNum() const
+		{
+			return m_blocksByOffset.size();
+		}
+
+		bool IsFullyMerged() const
+		{
+			return m_blocksByOffset.size() == 1 && m_blocksByOffset.begin()->first == 0 &&
+				m_blocksByOffset.begin()->second == m_totalSize;
+		}
+
+	private:
+		char* m_start_ptr = nullptr;
+		TLock m_lock;
+		BlocksBySize m_blocksBySize;
+		BlocksByOffset m_blocksByOffset;
+	};
+} // namespace MemAlloc